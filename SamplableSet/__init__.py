@@ -1,3 +1,2 @@
-from ._wrapper import SamplableSet
-from _SamplableSet import * # keep original object available
-SamplableSet.__module__ = 'SamplableSet' # Completes the wrapping to be invisible
+from _SamplableSet import *
+SamplableSet.__module__ = 'SamplableSet' # Pickled sets refer to the package
@@ -39,6 +39,7 @@
 
 from setuptools import setup, Extension
 from setuptools.command.build_ext import build_ext
+import os
 import sys
 import setuptools
 
@@ -64,12 +65,20 @@ ext_modules = [
     Extension(
         '_SamplableSet',
         ['src/bind_SamplableSet.cpp', 'src/HashPropensity.cpp',
-         'src/BinaryTree.cpp', 'src/SamplableSet.cpp'],
+         'src/BinaryTree.cpp', 'src/SamplableSet.cpp', 'src/Snapshot.cpp',
+         'src/MappedFile.cpp', 'src/Loader.cpp', 'src/Journal.cpp',
+         'src/SharedMemory.cpp'],
         include_dirs=[
             'src/',
             get_pybind_include(),
             get_pybind_include(user=True)
         ],
+        # shm_open is in librt on Linux before glibc 2.34
+        libraries=['rt'] if sys.platform.startswith('linux') else [],
+        # SAMPLABLESET_INSTRUMENTATION=1 compiles the counters of the sets
+        define_macros=([('SAMPLABLESET_INSTRUMENTATION', None)]
+                       if os.environ.get('SAMPLABLESET_INSTRUMENTATION')
+                       else []),
         language='c++'
     ),
 ]
@@ -39,6 +39,7 @@ BinaryTree::BinaryTree() :
     leaves_vector_(),
     leaves_index_map_()
 {
+    SSET_INSTRUMENT(node_visits_ = 0;)
 }
 
 //Constructor of the class BinaryTree with specified leaves number
@@ -48,6 +49,7 @@ BinaryTree::BinaryTree(unsigned int n_leaves) :
     leaves_vector_(),
     leaves_index_map_()
 {
+    SSET_INSTRUMENT(node_visits_ = 0;)
     if (n_leaves < 1)
     {
         cout << "Impossible tree" << endl;
@@ -71,6 +73,7 @@ BinaryTree::BinaryTree(const BinaryTree& tree) :
     leaves_vector_(),
     leaves_index_map_()
 {
+    SSET_INSTRUMENT(node_visits_ = 0;)
     //Construct a new tree with n_leaves
     unsigned int n_leaves = tree.leaves_vector_.size();
     BinaryTreeNode* root = new BinaryTreeNode;
@@ -132,8 +135,10 @@ LeafIndex BinaryTree::get_leaf_index(double r)
 {
     double cumul = 0;
     double total_value = get_value();
+    SSET_INSTRUMENT(node_visits_++;)
     while (not is_leaf())
     {
+        SSET_INSTRUMENT(node_visits_++;)
         if (r <= (cumul + get_value_left())/total_value)
         {
             move_down_left();
@@ -188,15 +193,28 @@ void BinaryTree::destroy_tree(BinaryTreeNode* node)
   }
 }
 
+//Recursively set the value of the internal nodes to the sum of their leaves
+double BinaryTree::sum_subtree(BinaryTreeNode* node)
+{
+    if (node->child_left != nullptr and node->child_right != nullptr)
+    {
+        node->value = sum_subtree(node->child_left) +
+            sum_subtree(node->child_right);
+    }
+    return node->value;
+}
+
 //update value for the leaf and parents
 void BinaryTree::update_value(LeafIndex leaf_index, double variation)
 {
     current_node_ = leaves_vector_[leaf_index];
     (current_node_->value) += variation;
+    SSET_INSTRUMENT(node_visits_++;)
     while(not is_root())
     {
         move_up();
         (current_node_->value) += variation;
+        SSET_INSTRUMENT(node_visits_++;)
     }
 }
 
@@ -206,10 +224,12 @@ void BinaryTree::update_value(double variation)
     if (is_leaf())
     {
         (current_node_->value) += variation;
+        SSET_INSTRUMENT(node_visits_++;)
         while(not is_root())
         {
             move_up();
             (current_node_->value) += variation;
+            SSET_INSTRUMENT(node_visits_++;)
         }
     }
     else
@@ -235,6 +255,18 @@ void BinaryTree::update_zero()
     }
 }
 
+//set the value of all leaves, then compute the parents bottom-up
+void BinaryTree::set_leaf_values(const vector<double>& value_vector)
+{
+    for (LeafIndex leaf_index = 0; leaf_index < leaves_vector_.size();
+            leaf_index++)
+    {
+        leaves_vector_[leaf_index]->value = value_vector.at(leaf_index);
+    }
+    sum_subtree(root_);
+    reset_current_node();
+}
+
 //remove value for all nodes
 void BinaryTree::clear()
 {
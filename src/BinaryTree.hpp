@@ -28,6 +28,10 @@
 #include <vector>
 #include <unordered_map>
 #include <cmath>
+#include <algorithm>
+#include "binomial.hpp"
+#include "Instrumentation.hpp"
+#include "MemoryUsage.hpp"
 
 namespace sset
 {//start of namespace sset
@@ -76,6 +80,18 @@ public:
     LeafIndex get_leaf_index() const
         {return leaves_index_map_.at(current_node_);}
     LeafIndex get_leaf_index(double r);
+    double get_leaf_value(LeafIndex leaf_index) const
+        {return leaves_vector_.at(leaf_index)->value;}
+    template <class RNG>
+    std::vector<unsigned long> get_leaf_counts(unsigned long n,
+            RNG& gen) const;
+    std::size_t node_bytes() const
+        {return leaves_vector_.empty() ? 0 :
+            (2*leaves_vector_.size() - 1)*sizeof(BinaryTreeNode);}
+    std::size_t leaf_index_bytes() const
+        {return leaves_vector_.capacity()*sizeof(BinaryTreeNode*) +
+            hash_map_bucket_bytes(leaves_index_map_) +
+            hash_map_node_bytes(leaves_index_map_);}
 
     //Mutators
     void reset_current_node()
@@ -91,8 +107,18 @@ public:
     void update_value(LeafIndex leaf_index, double variation);
     void update_value(double variation);
     void update_zero();
+    void set_leaf_values(const std::vector<double>& value_vector);
     void clear();
 
+    //Instrumentation, counting the nodes visited by walks in the tree
+#ifdef SAMPLABLESET_INSTRUMENTATION
+    uint64_t node_visits() const {return node_visits_;}
+    void reset_node_visits() {node_visits_ = 0;}
+#else
+    uint64_t node_visits() const {return 0;}
+    void reset_node_visits() {}
+#endif
+
 
 private:
     //Members
@@ -100,6 +126,9 @@ private:
     BinaryTreeNode* current_node_;
     std::vector<BinaryTreeNode*> leaves_vector_;
     std::unordered_map<BinaryTreeNode*,LeafIndex> leaves_index_map_;
+#ifdef SAMPLABLESET_INSTRUMENTATION
+    mutable uint64_t node_visits_;
+#endif
 
     //To be called by constructors and assignement operator
     BinaryTreeNode* branch(BinaryTreeNode* parent, int node_index,
@@ -108,8 +137,64 @@ private:
     //to be called by destructor
     void destroy_tree(BinaryTreeNode* node);
 
+    //to be called by set_leaf_values
+    double sum_subtree(BinaryTreeNode* node);
+
+    //to be called by get_leaf_counts
+    template <class RNG>
+    void split_count(BinaryTreeNode* node, unsigned long n, RNG& gen,
+            std::vector<unsigned long>& leaf_count_vector) const;
+
 };
 
+//Distribute n draws among the leaves, with probabilities proportional to
+//their values, using binomial splits down the tree
+template <class RNG>
+std::vector<unsigned long> BinaryTree::get_leaf_counts(unsigned long n,
+        RNG& gen) const
+{
+    std::vector<unsigned long> leaf_count_vector(leaves_vector_.size(), 0);
+    split_count(root_, n, gen, leaf_count_vector);
+    return leaf_count_vector;
+}
+
+//Recursive method to split the draws between the children of a node
+template <class RNG>
+void BinaryTree::split_count(BinaryTreeNode* node, unsigned long n, RNG& gen,
+        std::vector<unsigned long>& leaf_count_vector) const
+{
+    if (n == 0)
+    {
+        return;
+    }
+    SSET_INSTRUMENT(node_visits_++;)
+    if (node->child_left == nullptr and node->child_right == nullptr)
+    {
+        leaf_count_vector[leaves_index_map_.at(node)] += n;
+    }
+    else
+    {
+        //empty subtrees get no draw, without drawing any variate
+        unsigned long n_left;
+        if (node->child_left->value <= 0.)
+        {
+            n_left = 0;
+        }
+        else if (node->child_right->value <= 0.)
+        {
+            n_left = n;
+        }
+        else
+        {
+            double p = std::min(std::max(
+                        node->child_left->value/node->value, 0.), 1.);
+            n_left = binomial(n, p, gen);
+        }
+        split_count(node->child_left, n_left, gen, leaf_count_vector);
+        split_count(node->child_right, n - n_left, gen, leaf_count_vector);
+    }
+}
+
 
 }//end of namespace sset
 
@@ -0,0 +1,223 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GILLESPIE_HPP_
+#define GILLESPIE_HPP_
+
+#include "SamplableSet.hpp"
+#include "NextReactionSet.hpp"
+#include <vector>
+#include <random>
+#include <limits>
+#include <unordered_map>
+
+namespace sset
+{//start of namespace sset
+
+
+//Events fired during a simulation and their time of occurrence
+template <class T>
+struct EventLog
+{
+    std::vector<double> time;
+    std::vector<T> element;
+};
+
+//Update rule that leaves the set unchanged after an event
+struct NoUpdate
+{
+    template <class T, class Set>
+    void operator()(const T&, Set&) const {}
+};
+
+//Update rule that removes the fired element from the set
+struct EraseFired
+{
+    template <class T, class Set>
+    void operator()(const T& element, Set& set) const {set.erase(element);}
+};
+
+//Change of the weight of an element after an event
+template <class T>
+struct WeightChange
+{
+    T element;
+    double value;
+    bool relative; //the value is added to the weight instead of replacing it
+};
+
+/*
+ * Update rule applying a table of weight changes for each fired element,
+ * e.g. the stoichiometry of the reactions. An element is erased when its new
+ * weight is not positive and inserted when it is absent from the set.
+ */
+template <class T>
+class ReactionTable
+{
+public:
+    //Accessors
+    std::size_t size() const {return change_map_.size();}
+
+    //Mutators
+    void add_change(const T& fired, const T& element, double value,
+            bool relative = false)
+        {change_map_[fired].push_back(WeightChange<T>{element, value,
+            relative});}
+    template <class Set>
+    void operator()(const T& element, Set& set) const;
+
+private:
+    std::unordered_map<T, std::vector<WeightChange<T> > > change_map_;
+};
+
+
+//apply the weight changes of the fired element
+template <typename T>
+template <class Set>
+void ReactionTable<T>::operator()(const T& element, Set& set) const
+{
+    auto iter = change_map_.find(element);
+    if (iter == change_map_.end())
+    {
+        return;
+    }
+    for (const WeightChange<T>& change : iter->second)
+    {
+        double weight = change.value;
+        if (change.relative and set.count(change.element))
+        {
+            weight += set.get_weight(change.element);
+        }
+        if (weight > 0)
+        {
+            set.set_weight(change.element, weight);
+        }
+        else
+        {
+            set.erase(change.element);
+        }
+    }
+}
+
+
+/*
+ * Gillespie's direct method. The elements of a samplable set are reactions
+ * firing with rates equal to their weights. After each event, an update rule
+ * is called with the fired element and the set, and can modify the set.
+ * The waiting times are drawn with the given RNG, the shared one by default.
+ */
+template <class T>
+class DirectMethod
+{
+public:
+    //Default constructor
+    DirectMethod(double time = 0., RNGType& gen = BaseSamplableSet::rng()) :
+        time_(time), gen_(gen), waiting_time_(1.) {}
+
+    //Accessors
+    double time() const {return time_;}
+
+    //Mutators
+    void set_time(double time) {time_ = time;}
+    template <class UpdateRule, class Index>
+    EventLog<T> run(SamplableSet<T,Index>& set, UpdateRule update,
+            std::size_t max_events,
+            double max_time = std::numeric_limits<double>::infinity());
+
+private:
+    double time_;
+    RNGType& gen_;
+    std::exponential_distribution<double> waiting_time_;
+};
+
+
+//fire events until max_events are fired, max_time is reached or no reaction
+//is left
+template <typename T>
+template <class UpdateRule, class Index>
+EventLog<T> DirectMethod<T>::run(SamplableSet<T,Index>& set,
+        UpdateRule update, std::size_t max_events, double max_time)
+{
+    EventLog<T> log;
+    while (log.time.size() < max_events and not set.empty())
+    {
+        double time = time_ + waiting_time_(gen_)/set.total_weight();
+        if (time > max_time)
+        {
+            //the process is memoryless, the next event can be discarded
+            time_ = max_time;
+            break;
+        }
+        time_ = time;
+        T element = set.sample_ext_RNG(gen_).first;
+        log.time.push_back(time_);
+        log.element.push_back(element);
+        update(element, set);
+    }
+    return log;
+}
+
+
+/*
+ * Gibson and Bruck's next reaction method. It has the same interface as
+ * DirectMethod, but the time is held by the next reaction set.
+ */
+template <class T>
+class NextReactionMethod
+{
+public:
+    //Mutators
+    template <class UpdateRule>
+    EventLog<T> run(NextReactionSet<T>& set, UpdateRule update,
+            std::size_t max_events,
+            double max_time = std::numeric_limits<double>::infinity());
+};
+
+
+//fire events until max_events are fired, max_time is reached or no reaction
+//is left
+template <typename T>
+template <class UpdateRule>
+EventLog<T> NextReactionMethod<T>::run(NextReactionSet<T>& set,
+        UpdateRule update, std::size_t max_events, double max_time)
+{
+    EventLog<T> log;
+    while (log.time.size() < max_events and not set.empty())
+    {
+        if (set.next_time() > max_time)
+        {
+            set.advance_time(max_time);
+            break;
+        }
+        T element = set.sample().first;
+        log.time.push_back(set.time());
+        log.element.push_back(element);
+        update(element, set);
+    }
+    return log;
+}
+
+}//end of namespace sset
+
+#endif /* GILLESPIE_HPP_ */
@@ -68,4 +68,18 @@ size_t HashPropensity::operator()(double propensity) const
     return index;
 }
 
+//Upper bounds of the groups, each one is twice the previous one except
+//the last one which is the maximal propensity
+vector<double> HashPropensity::max_propensities() const
+{
+    vector<double> max_propensity_vector((*this)(propensity_max_)+1,
+            2*propensity_min_);
+    for (size_t i = 1; i + 1 < max_propensity_vector.size(); i++)
+    {
+        max_propensity_vector[i] = max_propensity_vector[i-1]*2;
+    }
+    max_propensity_vector.back() = propensity_max_;
+    return max_propensity_vector;
+}
+
 }//end of namespace sset
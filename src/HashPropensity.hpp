@@ -26,6 +26,7 @@
 #define HASHPROPENSITY_HPP_
 
 #include <cstdlib>
+#include <vector>
 
 namespace sset
 {//start of namespace sset
@@ -41,6 +42,8 @@ public:
 
     //Call operator definition
     std::size_t operator()(double propensity) const;
+    //upper bound of the propensities hashed to each group
+    std::vector<double> max_propensities() const;
 
 private:
     //Members
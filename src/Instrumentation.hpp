@@ -0,0 +1,65 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef INSTRUMENTATION_HPP_
+#define INSTRUMENTATION_HPP_
+
+#include <cstdint>
+
+//Statements counting the work done by the sets, compiled only when
+//SAMPLABLESET_INSTRUMENTATION is defined so that they cost nothing otherwise
+#ifdef SAMPLABLESET_INSTRUMENTATION
+#define SSET_INSTRUMENT(statement) statement
+#else
+#define SSET_INSTRUMENT(statement)
+#endif
+
+namespace sset
+{//start of namespace sset
+
+//true if the counters are compiled in
+constexpr bool instrumented()
+{
+#ifdef SAMPLABLESET_INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+//Counters of a set, always zero without instrumentation
+struct InstrumentationCounters
+{
+    InstrumentationCounters() : samples(0), rejection_trials(0),
+        group_changes(0), tree_node_visits(0), hash_probes(0) {}
+    uint64_t samples; //elements drawn
+    uint64_t rejection_trials; //candidates drawn in groups, accepted or not
+    uint64_t group_changes; //weight changes moving an element to a group
+    uint64_t tree_node_visits; //nodes read or updated in the tree
+    uint64_t hash_probes; //buckets and nodes read by position map lookups
+};
+
+}//end of namespace sset
+
+#endif /* INSTRUMENTATION_HPP_ */
@@ -0,0 +1,111 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Journal.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+namespace sset
+{//start of namespace sset
+
+const char JOURNAL_MAGIC[] = "SSETJRNL";
+const size_t JOURNAL_MAGIC_SIZE = 8;
+
+//create the journal file and write its header
+JournalWriter::JournalWriter(const string& path, const string& signature,
+        size_t flush_size) :
+    file_(path, ios::binary | ios::trunc),
+    path_(path),
+    buffer_(),
+    flush_size_(flush_size)
+{
+    if (not file_)
+    {
+        throw runtime_error("Cannot open " + path + " for writing");
+    }
+    buffer_.reserve(flush_size_ + 64);
+    buffer_.append(JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE);
+    Serializer<uint32_t>::write(JOURNAL_VERSION, buffer_);
+    Serializer<uint32_t>::write(0, buffer_);
+    Serializer<string>::write(signature, buffer_);
+    flush();
+}
+
+//write the remaining entries, errors cannot be reported at this point
+JournalWriter::~JournalWriter()
+{
+    try
+    {
+        flush();
+    }
+    catch (...)
+    {
+    }
+}
+
+void JournalWriter::flush()
+{
+    if (not file_.write(buffer_.data(), buffer_.size()) or not file_.flush())
+    {
+        throw runtime_error("Cannot write to " + path_);
+    }
+    buffer_.clear();
+}
+
+string read_journal_header(const char*& cursor, const char* end)
+{
+    if (end - cursor < static_cast<ptrdiff_t>(JOURNAL_MAGIC_SIZE) or
+            string(cursor, JOURNAL_MAGIC_SIZE) != JOURNAL_MAGIC)
+    {
+        throw invalid_argument("Not a samplable set journal");
+    }
+    cursor += JOURNAL_MAGIC_SIZE;
+    uint32_t version = Serializer<uint32_t>::read(cursor, end);
+    if (version != JOURNAL_VERSION)
+    {
+        throw invalid_argument("Unsupported journal version "
+                + to_string(version));
+    }
+    Serializer<uint32_t>::read(cursor, end);
+    return Serializer<string>::read(cursor, end);
+}
+
+string read_journal_file(const string& path)
+{
+    ifstream file(path, ios::binary | ios::ate);
+    if (not file)
+    {
+        throw runtime_error("Cannot open " + path + " for reading");
+    }
+    string data(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    if (not file.read(&data[0], data.size()))
+    {
+        throw runtime_error("Cannot read " + path);
+    }
+    return data;
+}
+
+}//end of namespace sset
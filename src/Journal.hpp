@@ -0,0 +1,85 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JOURNAL_HPP_
+#define JOURNAL_HPP_
+
+#include "Serializer.hpp"
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+namespace sset
+{//start of namespace sset
+
+/*
+ * Journals of the modifications of samplable sets. A journal starts with
+ * the magic "SSETJRNL", a uint32 version, a uint32 left at 0 and the key
+ * signature (uint64 length and characters), followed by the entries:
+ *   uint8 operation, then the key for all operations but clear, then the
+ *   double weight for insert and set_weight.
+ * All numbers are little-endian.
+ */
+const uint32_t JOURNAL_VERSION = 1;
+const std::size_t JOURNAL_FLUSH_SIZE = 1 << 16; //bytes buffered by default
+
+enum JournalOperation : uint8_t
+{
+    JOURNAL_INSERT = 0,
+    JOURNAL_SET_WEIGHT,
+    JOURNAL_ERASE,
+    JOURNAL_CLEAR
+};
+
+//Buffered writer of a journal, the entries are written to the file once
+//the buffer holds flush_size bytes, on flush and on destruction
+class JournalWriter
+{
+public:
+    JournalWriter(const std::string& path, const std::string& signature,
+            std::size_t flush_size = JOURNAL_FLUSH_SIZE);
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+    ~JournalWriter();
+
+    std::string& buffer() {return buffer_;}
+    void commit() {if (buffer_.size() >= flush_size_) flush();}
+    void flush();
+
+private:
+    std::ofstream file_;
+    std::string path_;
+    std::string buffer_;
+    std::size_t flush_size_;
+};
+
+//read the header of a journal, returns the key signature
+std::string read_journal_header(const char*& cursor, const char* end);
+
+//read a whole journal file
+std::string read_journal_file(const std::string& path);
+
+}//end of namespace sset
+
+#endif /* JOURNAL_HPP_ */
@@ -0,0 +1,287 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Loader.hpp"
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+namespace sset
+{//start of namespace sset
+
+//remove the blanks around a field, tabs are kept if they are delimiters
+TextField trim_field(const char* begin, const char* end, char delimiter)
+{
+    auto blank = [delimiter](char c)
+    {
+        return c == ' ' or c == '\r' or (c == '\t' and delimiter != '\t');
+    };
+    while (begin != end and blank(*begin))
+    {
+        begin++;
+    }
+    while (end != begin and blank(*(end-1)))
+    {
+        end--;
+    }
+    return TextField{begin, end};
+}
+
+void split_lines(const char* begin, const char* end, char delimiter,
+        size_t fields_per_line, vector<TextField>& field_vector)
+{
+    const char* line_begin = begin;
+    while (line_begin < end)
+    {
+        const char* line_end = static_cast<const char*>(
+                memchr(line_begin, '\n', end - line_begin));
+        if (line_end == nullptr)
+        {
+            line_end = end;
+        }
+        TextField line = trim_field(line_begin, line_end, delimiter);
+        if (line.begin != line.end)
+        {
+            size_t n_fields = 0;
+            const char* field_begin = line_begin;
+            for (const char* c = line_begin; c <= line_end; c++)
+            {
+                if (c == line_end or *c == delimiter)
+                {
+                    field_vector.push_back(trim_field(field_begin, c,
+                                delimiter));
+                    field_begin = c + 1;
+                    n_fields++;
+                }
+            }
+            if (n_fields != fields_per_line)
+            {
+                throw invalid_argument("Expected "
+                        + to_string(fields_per_line) + " fields in line "
+                        + string(line.begin, line.end));
+            }
+        }
+        line_begin = line_end + 1;
+    }
+}
+
+//check that a number was read from the whole field
+void number_checkup(const TextField& field, const char* number_end)
+{
+    if (field.begin == field.end or number_end != field.end or
+            errno == ERANGE)
+    {
+        throw invalid_argument("Invalid number "
+                + string(field.begin, field.end));
+    }
+}
+
+long long parse_integer(const TextField& field)
+{
+    char* number_end = nullptr;
+    errno = 0;
+    long long value = field.begin == field.end ? 0 :
+        strtoll(field.begin, &number_end, 10);
+    number_checkup(field, number_end);
+    return value;
+}
+
+unsigned long long parse_unsigned_integer(const TextField& field)
+{
+    char* number_end = nullptr;
+    errno = 0;
+    if (field.begin != field.end and *field.begin == '-')
+    {
+        throw invalid_argument("Invalid number "
+                + string(field.begin, field.end));
+    }
+    unsigned long long value = field.begin == field.end ? 0 :
+        strtoull(field.begin, &number_end, 10);
+    number_checkup(field, number_end);
+    return value;
+}
+
+double parse_floating_point(const TextField& field)
+{
+    char* number_end = nullptr;
+    errno = 0;
+    double value = field.begin == field.end ? 0. :
+        strtod(field.begin, &number_end);
+    number_checkup(field, number_end);
+    return value;
+}
+
+//value of a key in the dictionary of a .npy header
+string npy_header_value(const string& dictionary, const string& key)
+{
+    size_t position = dictionary.find("'" + key + "'");
+    if (position == string::npos)
+    {
+        throw invalid_argument("Missing " + key + " in .npy header");
+    }
+    position = dictionary.find(':', position);
+    size_t value_end = dictionary.find(key == "shape" ? ')' : ',', position);
+    if (position == string::npos or value_end == string::npos)
+    {
+        throw invalid_argument("Invalid .npy header");
+    }
+    return dictionary.substr(position + 1, value_end - position);
+}
+
+NpyHeader read_npy_header(istream& stream)
+{
+    char preamble[10];
+    if (not stream.read(preamble, 10) or memcmp(preamble, "\x93NUMPY", 6))
+    {
+        throw invalid_argument("Not a .npy file");
+    }
+    //the length of the header is on 2 bytes in version 1, 4 afterward
+    uint32_t length = static_cast<unsigned char>(preamble[8]) |
+        static_cast<unsigned char>(preamble[9]) << 8;
+    if (preamble[6] != 1)
+    {
+        char extra_bytes[2];
+        if (not stream.read(extra_bytes, 2))
+        {
+            throw invalid_argument("Truncated .npy file");
+        }
+        length |= static_cast<uint32_t>(
+                static_cast<unsigned char>(extra_bytes[0])) << 16 |
+            static_cast<uint32_t>(
+                    static_cast<unsigned char>(extra_bytes[1])) << 24;
+    }
+    string dictionary(length, '\0');
+    if (not stream.read(&dictionary[0], length))
+    {
+        throw invalid_argument("Truncated .npy file");
+    }
+
+    NpyHeader header;
+    string descr = npy_header_value(dictionary, "descr");
+    size_t quote = descr.find('\'');
+    if (quote == string::npos or descr.size() < quote + 4)
+    {
+        throw invalid_argument("Invalid dtype in .npy header");
+    }
+    char byte_order = descr[quote+1];
+    header.kind = descr[quote+2];
+    header.item_size = strtoul(descr.c_str() + quote + 3, nullptr, 10);
+    bool little_endian_file = byte_order == '<' or (byte_order != '>' and
+            little_endian_host());
+    header.swap_bytes = little_endian_file != little_endian_host();
+    bool supported_kind = ((header.kind == 'i' or header.kind == 'u') and
+            (header.item_size == 1 or header.item_size == 2 or
+             header.item_size == 4 or header.item_size == 8)) or
+        (header.kind == 'f' and (header.item_size == 4 or
+                                 header.item_size == 8)) or
+        (header.kind == 'b' and header.item_size == 1);
+    if (not supported_kind)
+    {
+        throw invalid_argument("Unsupported dtype " + descr
+                + " in .npy file");
+    }
+
+    string shape = npy_header_value(dictionary, "shape");
+    const char* cursor = shape.c_str() + shape.find('(') + 1;
+    while (true)
+    {
+        char* number_end;
+        unsigned long long dimension = strtoull(cursor, &number_end, 10);
+        if (number_end == cursor)
+        {
+            break;
+        }
+        header.shape.push_back(dimension);
+        cursor = number_end + strspn(number_end, ", ");
+    }
+    if (header.shape.size() > 1 and
+            npy_header_value(dictionary, "fortran_order").find("True") !=
+            string::npos)
+    {
+        throw invalid_argument("Arrays in Fortran order are not supported");
+    }
+    return header;
+}
+
+//read a number of the size given by the header and widen it
+template <typename Number>
+Number read_npy_number(const char* bytes, bool swap_bytes)
+{
+    char number_bytes[sizeof(Number)];
+    memcpy(number_bytes, bytes, sizeof(Number));
+    if (swap_bytes)
+    {
+        reverse(number_bytes, number_bytes + sizeof(Number));
+    }
+    Number value;
+    memcpy(&value, number_bytes, sizeof(Number));
+    return value;
+}
+
+NpyScalar read_npy_scalar(const char* bytes, const NpyHeader& header)
+{
+    NpyScalar scalar = {header.kind, 0, 0, 0.};
+    bool swap = header.swap_bytes;
+    switch (header.kind)
+    {
+        case 'f':
+            scalar.floating_point = header.item_size == 4 ?
+                read_npy_number<float>(bytes, swap) :
+                read_npy_number<double>(bytes, swap);
+            break;
+        case 'i':
+            switch (header.item_size)
+            {
+                case 1: scalar.integer = read_npy_number<int8_t>(bytes, swap);
+                        break;
+                case 2: scalar.integer = read_npy_number<int16_t>(bytes, swap);
+                        break;
+                case 4: scalar.integer = read_npy_number<int32_t>(bytes, swap);
+                        break;
+                default: scalar.integer = read_npy_number<int64_t>(bytes,
+                                 swap);
+            }
+            break;
+        default:
+            switch (header.item_size)
+            {
+                case 1: scalar.unsigned_integer =
+                        read_npy_number<uint8_t>(bytes, swap);
+                        break;
+                case 2: scalar.unsigned_integer =
+                        read_npy_number<uint16_t>(bytes, swap);
+                        break;
+                case 4: scalar.unsigned_integer =
+                        read_npy_number<uint32_t>(bytes, swap);
+                        break;
+                default: scalar.unsigned_integer =
+                         read_npy_number<uint64_t>(bytes, swap);
+            }
+    }
+    return scalar;
+}
+
+}//end of namespace sset
@@ -0,0 +1,443 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOADER_HPP_
+#define LOADER_HPP_
+
+#include "SamplableSet.hpp"
+#include <string>
+#include <vector>
+#include <tuple>
+#include <thread>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include <cstdlib>
+
+namespace sset
+{//start of namespace sset
+
+const std::size_t LOADER_CHUNK_SIZE = 1 << 24; //bytes of text read at once
+const std::size_t LOADER_CHUNK_ROWS = 1 << 20; //rows of arrays read at once
+
+//field of a line of text, without the delimiters
+struct TextField
+{
+    const char* begin;
+    const char* end;
+};
+
+//split the lines in [begin, end) in fields; the fields of the lines that
+//are not empty are appended to field_vector
+void split_lines(const char* begin, const char* end, char delimiter,
+        std::size_t fields_per_line, std::vector<TextField>& field_vector);
+
+//parse a number from a field of text
+long long parse_integer(const TextField& field);
+unsigned long long parse_unsigned_integer(const TextField& field);
+double parse_floating_point(const TextField& field);
+
+//header of a .npy file
+struct NpyHeader
+{
+    char kind; //'i', 'u', 'f' or 'b', as in numpy's dtype.kind
+    std::size_t item_size;
+    bool swap_bytes; //byte order of the file differs from the host
+    std::vector<uint64_t> shape;
+};
+
+//read the header of a .npy file, the stream is left at the start of data
+NpyHeader read_npy_header(std::istream& stream);
+
+//value of an entry of a .npy file, stored in the widest type of its kind
+struct NpyScalar
+{
+    char kind;
+    int64_t integer;
+    uint64_t unsigned_integer;
+    double floating_point;
+};
+
+NpyScalar read_npy_scalar(const char* bytes, const NpyHeader& header);
+
+//conversion of a .npy value to the type of a component of the elements
+//integers are checked to be in the range of the type
+template <typename C>
+C npy_cast(const NpyScalar& scalar, std::true_type)
+{
+    switch (scalar.kind)
+    {
+        case 'i': return static_cast<C>(scalar.integer);
+        case 'f': return static_cast<C>(scalar.floating_point);
+        default: return static_cast<C>(scalar.unsigned_integer);
+    }
+}
+
+template <typename C>
+C npy_cast(const NpyScalar& scalar, std::false_type)
+{
+    bool in_range;
+    switch (scalar.kind)
+    {
+        case 'f':
+            throw std::invalid_argument("Expected integer elements");
+        case 'i':
+            in_range = scalar.integer < 0 ?
+                (std::is_signed<C>::value and scalar.integer >=
+                 static_cast<int64_t>(std::numeric_limits<C>::min())) :
+                (static_cast<uint64_t>(scalar.integer) <=
+                 static_cast<uint64_t>(std::numeric_limits<C>::max()));
+            if (in_range)
+            {
+                return static_cast<C>(scalar.integer);
+            }
+            break;
+        default:
+            if (scalar.unsigned_integer <=
+                    static_cast<uint64_t>(std::numeric_limits<C>::max()))
+            {
+                return static_cast<C>(scalar.unsigned_integer);
+            }
+    }
+    throw std::invalid_argument("Element out of the range of its type");
+}
+
+template <typename C>
+C npy_cast(const NpyScalar& scalar)
+{
+    return npy_cast<C>(scalar, std::is_floating_point<C>());
+}
+
+//Construction of the elements of a set from fields of text or from the
+//entries of a row of a .npy array. count is the number of fields.
+template <typename T, typename Enable = void>
+struct ElementFields;
+
+template <typename T>
+struct ElementFields<T,
+    typename std::enable_if<std::is_integral<T>::value and
+        std::is_signed<T>::value>::type>
+{
+    static constexpr std::size_t count() {return 1;}
+
+    static T parse(const TextField* fields)
+    {
+        long long value = parse_integer(*fields);
+        if (value < std::numeric_limits<T>::min() or
+                value > std::numeric_limits<T>::max())
+        {
+            throw std::invalid_argument("Element out of the range of its type");
+        }
+        return static_cast<T>(value);
+    }
+
+    static T build(const char* row, const NpyHeader& header)
+    {
+        return npy_cast<T>(read_npy_scalar(row, header));
+    }
+};
+
+template <typename T>
+struct ElementFields<T,
+    typename std::enable_if<std::is_integral<T>::value and
+        std::is_unsigned<T>::value>::type>
+{
+    static constexpr std::size_t count() {return 1;}
+
+    static T parse(const TextField* fields)
+    {
+        unsigned long long value = parse_unsigned_integer(*fields);
+        if (value > std::numeric_limits<T>::max())
+        {
+            throw std::invalid_argument("Element out of the range of its type");
+        }
+        return static_cast<T>(value);
+    }
+
+    static T build(const char* row, const NpyHeader& header)
+    {
+        return npy_cast<T>(read_npy_scalar(row, header));
+    }
+};
+
+template <>
+struct ElementFields<std::string>
+{
+    static constexpr std::size_t count() {return 1;}
+
+    static std::string parse(const TextField* fields)
+    {
+        return std::string(fields->begin, fields->end);
+    }
+};
+
+//tuples are read component by component
+template <class Tuple, std::size_t Index = std::tuple_size<Tuple>::value>
+struct TupleFields
+{
+    typedef typename std::tuple_element<Index-1, Tuple>::type Element;
+
+    static constexpr std::size_t count()
+    {
+        return TupleFields<Tuple, Index-1>::count() +
+            ElementFields<Element>::count();
+    }
+
+    static void parse(Tuple& value, const TextField* fields)
+    {
+        TupleFields<Tuple, Index-1>::parse(value, fields);
+        std::get<Index-1>(value) = ElementFields<Element>::parse(
+                fields + TupleFields<Tuple, Index-1>::count());
+    }
+
+    static void build(Tuple& value, const char* row, const NpyHeader& header)
+    {
+        TupleFields<Tuple, Index-1>::build(value, row, header);
+        std::get<Index-1>(value) = ElementFields<Element>::build(
+                row + TupleFields<Tuple, Index-1>::count()*header.item_size,
+                header);
+    }
+};
+
+template <class Tuple>
+struct TupleFields<Tuple, 0>
+{
+    static constexpr std::size_t count() {return 0;}
+    static void parse(Tuple&, const TextField*) {}
+    static void build(Tuple&, const char*, const NpyHeader&) {}
+};
+
+template <typename... TT>
+struct ElementFields<std::tuple<TT...> >
+{
+    static constexpr std::size_t count()
+    {
+        return TupleFields<std::tuple<TT...> >::count();
+    }
+
+    static std::tuple<TT...> parse(const TextField* fields)
+    {
+        std::tuple<TT...> value;
+        TupleFields<std::tuple<TT...> >::parse(value, fields);
+        return value;
+    }
+
+    static std::tuple<TT...> build(const char* row, const NpyHeader& header)
+    {
+        std::tuple<TT...> value;
+        TupleFields<std::tuple<TT...> >::build(value, row, header);
+        return value;
+    }
+};
+
+//parse the lines of a slice of text into pairs of elements and weights
+template <typename T>
+void parse_lines(const char* begin, const char* end, char delimiter,
+        std::vector<std::pair<T,double> >& element_weight_vector)
+{
+    const std::size_t fields_per_line = ElementFields<T>::count() + 1;
+    std::vector<TextField> field_vector;
+    split_lines(begin, end, delimiter, fields_per_line, field_vector);
+    element_weight_vector.clear();
+    element_weight_vector.reserve(field_vector.size()/fields_per_line);
+    for (std::size_t i = 0; i < field_vector.size(); i += fields_per_line)
+    {
+        element_weight_vector.push_back(std::make_pair(
+                    ElementFields<T>::parse(&field_vector[i]),
+                    parse_floating_point(field_vector[i+fields_per_line-1])));
+    }
+}
+
+/*
+ * Insert the elements of a text file in a set, each line holding the fields
+ * of an element followed by its weight (e.g. "3,5,2.5" for a tuple of two
+ * int). Fields are not quoted. The file is read by chunks of chunk_size
+ * bytes, whose lines are parsed by n_threads threads before the elements
+ * are inserted, so that the memory used is bounded by the size of a chunk.
+ * Elements already in the set are left unchanged, as with insert.
+ */
+template <typename T, typename Index>
+void load_text(SamplableSet<T,Index>& set, const std::string& path,
+        char delimiter = ',', bool skip_header = false,
+        unsigned int n_threads = 0,
+        std::size_t chunk_size = LOADER_CHUNK_SIZE)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (not file)
+    {
+        throw std::runtime_error("Cannot open " + path + " for reading");
+    }
+    if (n_threads == 0)
+    {
+        n_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    std::vector<std::vector<std::pair<T,double> > > parsed_vector(n_threads);
+    std::vector<std::exception_ptr> error_vector(n_threads);
+    std::string chunk;
+    std::string remainder;
+    bool header_pending = skip_header;
+    bool end_of_file = false;
+    while (not end_of_file)
+    {
+        //read a chunk, the incomplete last line is kept for the next one
+        chunk.swap(remainder);
+        std::size_t offset = chunk.size();
+        chunk.resize(offset + chunk_size);
+        file.read(&chunk[offset], chunk_size);
+        chunk.resize(offset + file.gcount());
+        end_of_file = not file;
+        remainder.clear();
+        if (not end_of_file)
+        {
+            std::size_t last_line_end = chunk.rfind('\n');
+            if (last_line_end == std::string::npos)
+            {
+                remainder.swap(chunk);
+                continue;
+            }
+            remainder.assign(chunk, last_line_end + 1, std::string::npos);
+            chunk.resize(last_line_end + 1);
+        }
+        if (header_pending)
+        {
+            std::size_t header_end = chunk.find('\n');
+            chunk.erase(0, header_end == std::string::npos ?
+                    chunk.size() : header_end + 1);
+            header_pending = false;
+        }
+
+        //parse slices of the chunk ending on complete lines in parallel
+        std::vector<std::thread> thread_vector;
+        const char* slice_begin = chunk.data();
+        const char* chunk_end = chunk.data() + chunk.size();
+        for (unsigned int i = 0; i < n_threads; i++)
+        {
+            const char* slice_end = chunk_end;
+            if (i + 1 < n_threads)
+            {
+                slice_end = std::min(chunk_end, slice_begin +
+                        (chunk_end - slice_begin)/(n_threads - i));
+                while (slice_end != chunk_end and slice_end != slice_begin
+                        and *(slice_end-1) != '\n')
+                {
+                    slice_end++;
+                }
+            }
+            thread_vector.push_back(std::thread(
+                [=, &parsed_vector, &error_vector]()
+                {
+                    try
+                    {
+                        parse_lines(slice_begin, slice_end, delimiter,
+                                parsed_vector[i]);
+                    }
+                    catch (...)
+                    {
+                        error_vector[i] = std::current_exception();
+                    }
+                }));
+            slice_begin = slice_end;
+        }
+        for (auto& thread : thread_vector)
+        {
+            thread.join();
+        }
+        for (unsigned int i = 0; i < n_threads; i++)
+        {
+            if (error_vector[i])
+            {
+                std::rethrow_exception(error_vector[i]);
+            }
+            for (const auto& element_weight_pair : parsed_vector[i])
+            {
+                set.insert(element_weight_pair.first,
+                        element_weight_pair.second);
+            }
+        }
+    }
+}
+
+/*
+ * Insert the elements of a .npy array in a set with the weights of another
+ * one. Elements are given in an array of shape (N,), or (N, k) for tuples
+ * of k numbers, in C order. Both files are read by chunks of chunk_rows
+ * rows. Elements already in the set are left unchanged, as with insert.
+ */
+template <typename T, typename Index>
+void load_npy(SamplableSet<T,Index>& set, const std::string& elements_path,
+        const std::string& weights_path,
+        std::size_t chunk_rows = LOADER_CHUNK_ROWS)
+{
+    std::ifstream elements_file(elements_path, std::ios::binary);
+    std::ifstream weights_file(weights_path, std::ios::binary);
+    if (not elements_file or not weights_file)
+    {
+        throw std::runtime_error("Cannot open " + (elements_file ?
+                    weights_path : elements_path) + " for reading");
+    }
+    NpyHeader elements_header = read_npy_header(elements_file);
+    NpyHeader weights_header = read_npy_header(weights_file);
+    const std::size_t width = ElementFields<T>::count();
+    const std::vector<uint64_t>& shape = elements_header.shape;
+    if (shape.empty() or (width == 1 ? shape.size() != 1 :
+                (shape.size() != 2 or shape[1] != width)))
+    {
+        throw std::invalid_argument("Elements of shape incompatible with "
+                "the type of the set");
+    }
+    if (weights_header.shape.size() != 1 or weights_header.shape[0] !=
+            shape[0])
+    {
+        throw std::invalid_argument("Expected one weight per element");
+    }
+    const std::size_t row_size = width*elements_header.item_size;
+    std::string element_buffer;
+    std::string weight_buffer;
+    for (uint64_t row = 0; row < shape[0]; row += chunk_rows)
+    {
+        std::size_t n_rows = std::min<uint64_t>(chunk_rows, shape[0] - row);
+        element_buffer.resize(n_rows*row_size);
+        weight_buffer.resize(n_rows*weights_header.item_size);
+        if (not elements_file.read(&element_buffer[0], element_buffer.size())
+                or not weights_file.read(&weight_buffer[0],
+                    weight_buffer.size()))
+        {
+            throw std::invalid_argument("Truncated .npy file");
+        }
+        for (std::size_t i = 0; i < n_rows; i++)
+        {
+            set.insert(ElementFields<T>::build(
+                        element_buffer.data() + i*row_size, elements_header),
+                    npy_cast<double>(read_npy_scalar(weight_buffer.data() +
+                            i*weights_header.item_size, weights_header)));
+        }
+    }
+}
+
+}//end of namespace sset
+
+#endif /* LOADER_HPP_ */
@@ -0,0 +1,135 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "MappedFile.hpp"
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace sset
+{//start of namespace sset
+
+#ifdef _WIN32
+
+//map the file with a read-only view
+MappedFile::MappedFile(const string& path) :
+    data_(nullptr),
+    size_(0),
+    mapping_(nullptr)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw runtime_error("Cannot open " + path + " for reading");
+    }
+    LARGE_INTEGER file_size;
+    if (not GetFileSizeEx(file, &file_size))
+    {
+        CloseHandle(file);
+        throw runtime_error("Cannot read the size of " + path);
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    if (size_ > 0)
+    {
+        mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0,
+                nullptr);
+        if (mapping_ != nullptr)
+        {
+            data_ = static_cast<const char*>(MapViewOfFile(mapping_,
+                        FILE_MAP_READ, 0, 0, 0));
+        }
+    }
+    CloseHandle(file);
+    if (size_ > 0 and data_ == nullptr)
+    {
+        if (mapping_ != nullptr)
+        {
+            CloseHandle(mapping_);
+        }
+        throw runtime_error("Cannot map " + path);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr)
+    {
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+    }
+}
+
+#else
+
+//map the file with mmap, the descriptor is not needed afterward
+MappedFile::MappedFile(const string& path) :
+    data_(nullptr),
+    size_(0)
+{
+    int file = open(path.c_str(), O_RDONLY);
+    if (file == -1)
+    {
+        throw runtime_error("Cannot open " + path + " for reading");
+    }
+    struct stat file_status;
+    if (fstat(file, &file_status) == -1)
+    {
+        close(file);
+        throw runtime_error("Cannot read the size of " + path);
+    }
+    size_ = static_cast<size_t>(file_status.st_size);
+    if (size_ > 0)
+    {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file, 0);
+        if (data == MAP_FAILED)
+        {
+            close(file);
+            throw runtime_error("Cannot map " + path);
+        }
+        data_ = static_cast<const char*>(data);
+    }
+    close(file);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+#endif
+
+}//end of namespace sset
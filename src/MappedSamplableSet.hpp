@@ -0,0 +1,239 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MAPPEDSAMPLABLESET_HPP_
+#define MAPPEDSAMPLABLESET_HPP_
+
+#include "SamplableSet.hpp"
+#include "MappedFile.hpp"
+#include "Snapshot.hpp"
+#include <string>
+#include <vector>
+#include <utility>
+#include <random>
+#include <stdexcept>
+#include <cmath>
+
+namespace sset
+{//start of namespace sset
+
+/*
+ * Read-only samplable set sampling directly from the groups of a snapshot
+ * file mapped in memory. The elements must have a fixed size, so that they
+ * can be accessed by their index in the group. Processes mapping the same
+ * file share its pages. Opening only reads the header and the sizes of the
+ * groups, unless the weights of the elements are validated.
+ */
+template <class T>
+class MappedSamplableSet : public BaseSamplableSet
+{
+public:
+    //Constructor
+    explicit MappedSamplableSet(const std::string& path,
+            bool validate = false);
+
+    //Accessors
+    std::size_t size() const {return size_;}
+    bool empty() const {return size() == 0;}
+    double total_weight() const {return sampling_tree_.get_value();}
+    double min_weight() const {return min_weight_;}
+    double max_weight() const {return max_weight_;}
+    std::size_t number_of_groups() const {return group_vector_.size();}
+    std::size_t group_size(GroupIndex group_index) const
+        {return group_vector_.at(group_index).size;}
+    std::pair<T,double> get_at(GroupIndex group_index,
+            uint64_t in_group_index) const;
+    std::pair<T,double> sample() const;
+    template <typename ExtRNG>
+    std::pair<T,double> sample_ext_RNG(ExtRNG& gen) const;
+
+private:
+    //position of a group in the mapped file
+    struct MappedGroup
+    {
+        uint64_t size;
+        const char* weights;
+        const char* elements;
+    };
+
+    MappedFile file_;
+    double min_weight_;
+    double max_weight_;
+    std::size_t size_;
+    mutable std::uniform_real_distribution<double> random_01_;
+    std::vector<double> max_propensity_vector_;
+    mutable BinaryTree sampling_tree_;
+    std::vector<MappedGroup> group_vector_;
+    //private method
+    double read_weight(const MappedGroup& group, uint64_t in_group_index) const;
+};
+
+//map the snapshot and locate its groups
+//the weights of the groups are read from the header to build the tree, they
+//are checked against the sizes of the groups, and against the weights of
+//the elements if validate is true
+template <typename T>
+MappedSamplableSet<T>::MappedSamplableSet(const std::string& path,
+        bool validate) :
+    file_(path),
+    min_weight_(0.),
+    max_weight_(0.),
+    size_(0),
+    random_01_(0.,1.),
+    max_propensity_vector_(),
+    sampling_tree_(),
+    group_vector_()
+{
+    const char* begin = file_.data();
+    const char* end = begin + file_.size();
+    const char* cursor = begin;
+    SnapshotHeader header = SnapshotHeader::read(cursor, begin, end);
+    if (header.signature != Serializer<T>::signature())
+    {
+        throw std::invalid_argument("Snapshot of elements of type "
+                + header.signature + " instead of "
+                + Serializer<T>::signature());
+    }
+    min_weight_ = header.min_weight;
+    max_weight_ = header.max_weight;
+    size_ = header.size;
+    HashPropensity hash(min_weight_, max_weight_);
+    std::size_t number_of_group = hash(max_weight_)+1;
+    if (header.number_of_groups != number_of_group)
+    {
+        throw std::invalid_argument("Inconsistent number of groups");
+    }
+    max_propensity_vector_ = hash.max_propensities();
+
+    const std::size_t element_size = Serializer<T>::fixed_size();
+    uint64_t total_size = 0;
+    for (std::size_t group_index = 0; group_index < number_of_group;
+            group_index++)
+    {
+        MappedGroup group;
+        group.size = Serializer<uint64_t>::read(cursor, end);
+        if (static_cast<uint64_t>(end - cursor)/(sizeof(double) +
+                    element_size) < group.size)
+        {
+            throw std::invalid_argument("Truncated serialized data");
+        }
+        group.weights = cursor;
+        group.elements = cursor + group.size*sizeof(double);
+        check_snapshot_group_bounds(header.group_weight_vector[group_index],
+                group.size, group_index == 0 ? min_weight_ :
+                max_propensity_vector_[group_index-1],
+                max_propensity_vector_[group_index]);
+        if (validate)
+        {
+            double weight_sum = 0.;
+            for (uint64_t i = 0; i < group.size; i++)
+            {
+                double weight = read_weight(group, i);
+                if (not (weight >= min_weight_ and weight <= max_weight_) or
+                        hash(weight) != group_index)
+                {
+                    throw std::invalid_argument(
+                            "Weight in the wrong group of the snapshot");
+                }
+                weight_sum += weight;
+            }
+            check_snapshot_group_weight(
+                    header.group_weight_vector[group_index], weight_sum);
+        }
+        cursor = group.elements + group.size*element_size;
+        skip_snapshot_padding(cursor, begin, end);
+        group_vector_.push_back(group);
+        total_size += group.size;
+    }
+    if (cursor != end or total_size != size_)
+    {
+        throw std::invalid_argument("Inconsistent size of the snapshot");
+    }
+    sampling_tree_ = BinaryTree(number_of_group);
+    sampling_tree_.set_leaf_values(header.group_weight_vector);
+}
+
+//weight of an element in a mapped group
+template <typename T>
+double MappedSamplableSet<T>::read_weight(const MappedGroup& group,
+        uint64_t in_group_index) const
+{
+    const char* cursor = group.weights + in_group_index*sizeof(double);
+    return Serializer<double>::read(cursor, cursor + sizeof(double));
+}
+
+//get an element and its weight from its position
+template <typename T>
+std::pair<T,double> MappedSamplableSet<T>::get_at(GroupIndex group_index,
+        uint64_t in_group_index) const
+{
+    const MappedGroup& group = group_vector_.at(group_index);
+    if (in_group_index >= group.size)
+    {
+        throw std::out_of_range("Index out of the group");
+    }
+    const std::size_t element_size = Serializer<T>::fixed_size();
+    const char* cursor = group.elements + in_group_index*element_size;
+    T element = Serializer<T>::read(cursor, cursor + element_size);
+    return std::make_pair(element, read_weight(group, in_group_index));
+}
+
+//sample an element according to its weight
+template <typename T>
+std::pair<T,double> MappedSamplableSet<T>::sample() const
+{
+    return sample_ext_RNG(gen_);
+}
+
+//sample an element according to its weight using an external RNG
+template <typename T>
+template <typename ExtRNG>
+std::pair<T,double> MappedSamplableSet<T>::sample_ext_RNG(ExtRNG& gen) const
+{
+    if (empty())
+    {
+        std::string out = "The samplable set is empty";
+        throw std::out_of_range(out);
+    }
+    //a draw at the boundary of an empty group is drawn again
+    GroupIndex group_index;
+    do
+    {
+        group_index = sampling_tree_.get_leaf_index(random_01_(gen));
+    }
+    while (group_vector_[group_index].size == 0);
+    const MappedGroup& group = group_vector_[group_index];
+    uint64_t in_group_index;
+    do
+    {
+        in_group_index = floor(random_01_(gen)*group.size);
+    }
+    while (random_01_(gen) >= read_weight(group, in_group_index)/
+            max_propensity_vector_[group_index]);
+    return get_at(group_index, in_group_index);
+}
+
+}//end of namespace sset
+
+#endif /* MAPPEDSAMPLABLESET_HPP_ */
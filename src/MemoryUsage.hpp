@@ -0,0 +1,73 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MEMORYUSAGE_HPP_
+#define MEMORYUSAGE_HPP_
+
+#include <cstddef>
+
+namespace sset
+{//start of namespace sset
+
+//Bytes used by the components of a set, computed from the sizes and the
+//capacities of its containers. Allocator overhead and memory owned by the
+//elements themselves (e.g. long strings) are not included.
+struct MemoryUsage
+{
+    MemoryUsage() : object(0), position_map_buckets(0), position_map_nodes(0),
+        group_elements(0), group_slack(0), group_vectors(0), tree_nodes(0),
+        tree_leaves(0) {}
+    std::size_t object; //the set itself
+    std::size_t position_map_buckets; //bucket array of the position map
+    std::size_t position_map_nodes; //one node per element of the set
+    std::size_t group_elements; //pairs (element, weight) in the groups
+    std::size_t group_slack; //capacity of the groups beyond their size
+    std::size_t group_vectors; //vectors of groups and of group bounds
+    std::size_t tree_nodes; //nodes of the binary tree
+    std::size_t tree_leaves; //vector and hash map indexing the leaves
+    std::size_t total() const
+        {return object + position_map_buckets + position_map_nodes +
+            group_elements + group_slack + group_vectors + tree_nodes +
+            tree_leaves;}
+};
+
+//bytes of the bucket array of an unordered_map
+template <class HashMap>
+std::size_t hash_map_bucket_bytes(const HashMap& hash_map)
+{
+    return hash_map.bucket_count()*sizeof(void*);
+}
+
+//bytes of the nodes of an unordered_map, each holding a value, the pointer
+//to the next node and the hash code (cached by libstdc++ for most keys)
+template <class HashMap>
+std::size_t hash_map_node_bytes(const HashMap& hash_map)
+{
+    return hash_map.size()*(sizeof(typename HashMap::value_type)
+            + sizeof(void*) + sizeof(std::size_t));
+}
+
+}//end of namespace sset
+
+#endif /* MEMORYUSAGE_HPP_ */
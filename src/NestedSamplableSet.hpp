@@ -0,0 +1,387 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NESTEDSAMPLABLESET_HPP_
+#define NESTEDSAMPLABLESET_HPP_
+
+#include "SamplableSet.hpp"
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <cmath>
+
+namespace sset
+{//start of namespace sset
+
+
+/*
+ * Two-level samplable set. Elements are grouped in subsets; a subset is
+ * sampled according to the total weight of its elements, then an element is
+ * sampled inside the subset. The weights of the outer level are kept equal
+ * to the total weights of the subsets.
+ *
+ * The outer level stores its position in each subset, so that the total
+ * weight of a subset is updated in the tree without any other lookup.
+ */
+template <class S, class T>
+class NestedSamplableSet : public BaseSamplableSet
+{
+public:
+    //Default constructor
+    NestedSamplableSet(double min_weight, double max_weight,
+            double max_total_weight);
+    //The groups of the outer level point to the entries of the subset map
+    NestedSamplableSet(const NestedSamplableSet<S,T>&) = delete;
+    NestedSamplableSet<S,T>& operator=(
+            const NestedSamplableSet<S,T>&) = delete;
+
+    //Accessors
+    std::size_t size() const {return size_;}
+    bool empty() const {return size() == 0;}
+    std::size_t number_of_subsets() const {return subset_map_.size();}
+    std::size_t count(const S& subset) const
+        {return subset_map_.count(subset);}
+    std::size_t count(const S& subset, const T& element) const;
+    std::pair<std::pair<S,T>,double> sample() const;
+    double total_weight() const {return sampling_tree_.get_value();}
+    double get_weight(const S& subset) const;
+    double get_weight(const S& subset, const T& element) const;
+    const SamplableSet<T>& get_subset(const S& subset) const;
+
+    //Mutators
+    void insert(const S& subset, const T& element, double weight = 0);
+    void set_weight(const S& subset, const T& element, double weight);
+    void erase(const S& subset, const T& element);
+    void erase(const S& subset);
+    void clear();
+
+private:
+    //Subset with its weight and position in the outer level
+    struct Subset
+    {
+        Subset(double min_weight, double max_weight) :
+            samplable_set(min_weight, max_weight),
+            weight(0.),
+            group_index(0),
+            in_group_index(0) {}
+        SamplableSet<T> samplable_set;
+        double weight;
+        GroupIndex group_index;
+        std::size_t in_group_index;
+    };
+    typedef std::unordered_map<S,Subset> SubsetMap;
+    typedef typename SubsetMap::value_type SubsetEntry;
+
+    double min_weight_;
+    double max_weight_;
+    double max_total_weight_;
+    std::size_t size_;
+    mutable std::uniform_real_distribution<double> random_01_;
+    HashPropensity hash_;
+    std::vector<double> max_propensity_vector_;
+    mutable BinaryTree sampling_tree_;
+    //entries of the subset map, which are not moved by rehashing
+    std::vector<std::vector<SubsetEntry*> > group_vector_;
+    SubsetMap subset_map_;
+    //private methods
+    void total_weight_checkup(double total_weight) const;
+    void place(SubsetEntry& entry, double weight);
+    void displace(SubsetEntry& entry);
+    void propagate(typename SubsetMap::iterator subset_iter);
+};
+
+
+//Default constructor for the class NestedSamplableSet
+template <typename S, typename T>
+NestedSamplableSet<S,T>::NestedSamplableSet(double min_weight,
+        double max_weight, double max_total_weight) :
+    min_weight_(min_weight),
+    max_weight_(max_weight),
+    max_total_weight_(max_total_weight),
+    size_(0),
+    random_01_(0.,1.),
+    hash_(min_weight, max_total_weight),
+    max_propensity_vector_(hash_.max_propensities()),
+    sampling_tree_(max_propensity_vector_.size()),
+    group_vector_(max_propensity_vector_.size()),
+    subset_map_()
+{
+}
+
+//throw a invalid_argument error if the total weight of a subset would be
+//out of bounds
+template <typename S, typename T>
+void NestedSamplableSet<S,T>::total_weight_checkup(double total_weight) const
+{
+    if (total_weight > max_total_weight_)
+    {
+        std::string out = "Total weight " + std::to_string(total_weight) +
+            " of the subset exceeds the maximal total weight " +
+            std::to_string(max_total_weight_);
+        throw std::invalid_argument(out);
+    }
+}
+
+//put a subset in the group of its weight and add the weight to the tree
+template <typename S, typename T>
+void NestedSamplableSet<S,T>::place(SubsetEntry& entry, double weight)
+{
+    Subset& subset = entry.second;
+    subset.weight = weight;
+    subset.group_index = hash_(weight);
+    std::vector<SubsetEntry*>& group = group_vector_[subset.group_index];
+    subset.in_group_index = group.size();
+    group.push_back(&entry);
+    sampling_tree_.update_value(subset.group_index, weight);
+}
+
+//remove a subset from its group and its weight from the tree
+template <typename S, typename T>
+void NestedSamplableSet<S,T>::displace(SubsetEntry& entry)
+{
+    Subset& subset = entry.second;
+    std::vector<SubsetEntry*>& group = group_vector_[subset.group_index];
+    //the last subset of the group takes its position
+    group[subset.in_group_index] = group.back();
+    group[subset.in_group_index]->second.in_group_index =
+        subset.in_group_index;
+    group.pop_back();
+    sampling_tree_.update_value(subset.group_index, -subset.weight);
+}
+
+//report the total weight of a subset to the outer level
+//empty subsets are removed
+template <typename S, typename T>
+void NestedSamplableSet<S,T>::propagate(
+        typename SubsetMap::iterator subset_iter)
+{
+    Subset& subset = subset_iter->second;
+    if (subset.samplable_set.empty())
+    {
+        displace(*subset_iter);
+        subset_map_.erase(subset_iter);
+    }
+    else
+    {
+        //guard against rounding errors below the lower bound
+        double weight = std::max(subset.samplable_set.total_weight(),
+                min_weight_);
+        if (hash_(weight) == subset.group_index)
+        {
+            sampling_tree_.update_value(subset.group_index,
+                    weight - subset.weight);
+            subset.weight = weight;
+        }
+        else
+        {
+            displace(*subset_iter);
+            place(*subset_iter, weight);
+        }
+    }
+}
+
+//return the count of an element in a subset (0 or 1)
+template <typename S, typename T>
+std::size_t NestedSamplableSet<S,T>::count(const S& subset,
+        const T& element) const
+{
+    auto subset_iter = subset_map_.find(subset);
+    return (subset_iter != subset_map_.end()) ?
+        subset_iter->second.samplable_set.count(element) : 0;
+}
+
+//sample a subset according to its total weight, then an element in it
+template <typename S, typename T>
+std::pair<std::pair<S,T>,double> NestedSamplableSet<S,T>::sample() const
+{
+    if (empty())
+    {
+        std::string out = "The samplable set is empty";
+        throw std::out_of_range(out);
+    }
+    GroupIndex group_index = sampling_tree_.get_leaf_index(random_01_(gen_));
+    const std::vector<SubsetEntry*>& group = group_vector_[group_index];
+    const SubsetEntry* entry;
+    do
+    {
+        entry = group[floor(random_01_(gen_)*group.size())];
+    }
+    while (random_01_(gen_) >=
+            entry->second.weight/max_propensity_vector_[group_index]);
+    std::pair<T,double> element_weight_pair =
+        entry->second.samplable_set.sample();
+    return std::make_pair(std::make_pair(entry->first,
+                element_weight_pair.first), element_weight_pair.second);
+}
+
+//get the total weight of a subset if it exists
+template <typename S, typename T>
+double NestedSamplableSet<S,T>::get_weight(const S& subset) const
+{
+    return get_subset(subset).total_weight();
+}
+
+//get the weight of an element in a subset if it exists
+template <typename S, typename T>
+double NestedSamplableSet<S,T>::get_weight(const S& subset,
+        const T& element) const
+{
+    return get_subset(subset).get_weight(element);
+}
+
+//get the subset if it exists
+template <typename S, typename T>
+const SamplableSet<T>& NestedSamplableSet<S,T>::get_subset(
+        const S& subset) const
+{
+    auto subset_iter = subset_map_.find(subset);
+    if (subset_iter == subset_map_.end())
+    {
+        std::string out = "Key error, the subset is not in the set";
+        throw std::out_of_range(out);
+    }
+    return subset_iter->second.samplable_set;
+}
+
+//insert an element in a subset with its associated weight
+//if the element is already there, do nothing
+template <typename S, typename T>
+void NestedSamplableSet<S,T>::insert(const S& subset, const T& element,
+        double weight)
+{
+    auto subset_iter = subset_map_.find(subset);
+    bool new_subset = (subset_iter == subset_map_.end());
+    if (new_subset)
+    {
+        total_weight_checkup(weight);
+        subset_iter = subset_map_.emplace(subset,
+                Subset(min_weight_, max_weight_)).first;
+    }
+    else if (not subset_iter->second.samplable_set.count(element))
+    {
+        total_weight_checkup(subset_iter->second.samplable_set.total_weight()
+                + weight);
+    }
+    SamplableSet<T>& inner_set = subset_iter->second.samplable_set;
+    std::size_t subset_size = inner_set.size();
+    try
+    {
+        inner_set.insert(element, weight);
+    }
+    catch (const std::invalid_argument&)
+    {
+        //do not leave a new empty subset behind
+        if (new_subset)
+        {
+            subset_map_.erase(subset_iter);
+        }
+        throw;
+    }
+    size_ += inner_set.size() - subset_size;
+    if (new_subset)
+    {
+        place(*subset_iter, std::max(inner_set.total_weight(), min_weight_));
+    }
+    else
+    {
+        propagate(subset_iter);
+    }
+}
+
+//set a new weight for an element in a subset
+//if the element does not exists, same as insert
+template <typename S, typename T>
+void NestedSamplableSet<S,T>::set_weight(const S& subset, const T& element,
+        double weight)
+{
+    auto subset_iter = subset_map_.find(subset);
+    double previous_weight;
+    if (subset_iter == subset_map_.end() or
+            not subset_iter->second.samplable_set.update_weight(element,
+                weight, previous_weight))
+    {
+        insert(subset, element, weight);
+        return;
+    }
+    SamplableSet<T>& inner_set = subset_iter->second.samplable_set;
+    double total_weight = inner_set.total_weight();
+    if (total_weight > max_total_weight_)
+    {
+        //restore the previous weight before reporting the error
+        inner_set.update_weight(element, previous_weight, previous_weight);
+        total_weight_checkup(total_weight);
+    }
+    propagate(subset_iter);
+}
+
+//Remove an element from a subset
+template <typename S, typename T>
+void NestedSamplableSet<S,T>::erase(const S& subset, const T& element)
+{
+    auto subset_iter = subset_map_.find(subset);
+    if (subset_iter != subset_map_.end())
+    {
+        SamplableSet<T>& inner_set = subset_iter->second.samplable_set;
+        std::size_t subset_size = inner_set.size();
+        inner_set.erase(element);
+        if (inner_set.size() != subset_size)
+        {
+            size_ -= 1;
+            propagate(subset_iter);
+        }
+    }
+}
+
+//Remove a subset and all its elements
+template <typename S, typename T>
+void NestedSamplableSet<S,T>::erase(const S& subset)
+{
+    auto subset_iter = subset_map_.find(subset);
+    if (subset_iter != subset_map_.end())
+    {
+        size_ -= subset_iter->second.samplable_set.size();
+        displace(*subset_iter);
+        subset_map_.erase(subset_iter);
+    }
+}
+
+//Remove all elements from the set
+template <typename S, typename T>
+void NestedSamplableSet<S,T>::clear()
+{
+    sampling_tree_.clear();
+    for (auto& group : group_vector_)
+    {
+        group.clear();
+    }
+    subset_map_.clear();
+    size_ = 0;
+}
+
+}//end of namespace sset
+
+#endif /* NESTEDSAMPLABLESET_HPP_ */
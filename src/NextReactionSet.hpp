@@ -0,0 +1,347 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NEXTREACTIONSET_HPP_
+#define NEXTREACTIONSET_HPP_
+
+#include "SamplableSet.hpp"
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <random>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+
+namespace sset
+{//start of namespace sset
+
+typedef std::size_t HeapIndex;
+
+//Minimal number of weight changes between two exact sums of the weights
+const std::size_t TOTAL_WEIGHT_RESYNC_PERIOD = 1024;
+
+//Element of the set with its weight and putative firing time
+template <class T>
+struct Reaction
+{
+    T element;
+    double weight;
+    double time;
+};
+
+
+/*
+ * Set of elements scheduled with Gibson and Bruck's next reaction method.
+ * Elements are reactions firing with rates equal to their weights. Putative
+ * firing times are stored in an indexed binary heap, and rescaled when
+ * the weight of an element changes. The interface mirrors SamplableSet.
+ *
+ * The times belong to the elements, so the method needs its own container
+ * instead of driving a SamplableSet like DirectMethod. The total weight is
+ * updated incrementally and summed again from the heap periodically, so that
+ * rounding errors do not accumulate.
+ */
+template <class T>
+class NextReactionSet : public BaseSamplableSet
+{
+public:
+    //Default constructor
+    NextReactionSet(double min_weight, double max_weight, double time = 0.);
+
+    //Accessors
+    std::size_t size() const {return position_map_.size();}
+    bool empty() const {return size() == 0;}
+    std::size_t inline count(const T& element) const
+        {return position_map_.count(element);}
+    double total_weight() const {return total_weight_;}
+    double get_weight(const T& element) const;
+    double time() const {return time_;}
+    double next_time() const;
+
+    //Mutators
+    std::pair<T,double> sample();
+    void insert(const T& element, double weight = 0);
+    void set_weight(const T& element, double weight);
+    void erase(const T& element);
+    void advance_time(double time);
+    void clear();
+
+private:
+    double min_weight_;
+    double max_weight_;
+    double time_;
+    double total_weight_;
+    std::size_t weight_changes_; //since the last exact sum of the weights
+    std::exponential_distribution<double> waiting_time_;
+    std::unordered_map<T,HeapIndex> position_map_;
+    std::vector<Reaction<T> > heap_;
+    //private methods
+    void weight_checkup(double weight) const;
+    void swap_nodes(HeapIndex i, HeapIndex j);
+    void sift_up(HeapIndex index);
+    void sift_down(HeapIndex index);
+    void update(HeapIndex index);
+    void change_total_weight(double variation);
+};
+
+
+//Default constructor for the class NextReactionSet
+template <typename T>
+NextReactionSet<T>::NextReactionSet(double min_weight, double max_weight,
+        double time) :
+    min_weight_(min_weight),
+    max_weight_(max_weight),
+    time_(time),
+    total_weight_(0.),
+    weight_changes_(0),
+    waiting_time_(1.),
+    position_map_(),
+    heap_()
+{
+    if (min_weight <= 0. or std::isinf(max_weight) or max_weight < min_weight)
+    {
+        throw std::invalid_argument("Invalid minimal or maximal weight");
+    }
+}
+
+//throw a invalid_argument error if the weight is out of bounds
+template <typename T>
+void NextReactionSet<T>::weight_checkup(double weight) const
+{
+    if (not (weight >= min_weight_ and weight <= max_weight_))
+    {
+        std::string out = "Weight " + std::to_string(weight) + " out of bounds [" +
+            std::to_string(min_weight_) + "," + std::to_string(max_weight_) + "]";
+        throw std::invalid_argument(out);
+    }
+}
+
+//swap two nodes of the heap and their positions
+template <typename T>
+void NextReactionSet<T>::swap_nodes(HeapIndex i, HeapIndex j)
+{
+    std::swap(heap_[i], heap_[j]);
+    position_map_[heap_[i].element] = i;
+    position_map_[heap_[j].element] = j;
+}
+
+//move a node up until its parent fires before it
+template <typename T>
+void NextReactionSet<T>::sift_up(HeapIndex index)
+{
+    while (index > 0 and heap_[index].time < heap_[(index-1)/2].time)
+    {
+        swap_nodes(index, (index-1)/2);
+        index = (index-1)/2;
+    }
+}
+
+//move a node down until its children fire after it
+template <typename T>
+void NextReactionSet<T>::sift_down(HeapIndex index)
+{
+    HeapIndex first = index;
+    do
+    {
+        index = first;
+        HeapIndex left = 2*index+1;
+        HeapIndex right = 2*index+2;
+        if (left < heap_.size() and heap_[left].time < heap_[first].time)
+        {
+            first = left;
+        }
+        if (right < heap_.size() and heap_[right].time < heap_[first].time)
+        {
+            first = right;
+        }
+        if (first != index)
+        {
+            swap_nodes(index, first);
+        }
+    } while (first != index);
+}
+
+//restore the heap property after the time of a node has changed
+template <typename T>
+void NextReactionSet<T>::update(HeapIndex index)
+{
+    if (index > 0 and heap_[index].time < heap_[(index-1)/2].time)
+    {
+        sift_up(index);
+    }
+    else
+    {
+        sift_down(index);
+    }
+}
+
+//add a variation to the total weight, which is summed again from the heap
+//after a number of changes proportional to the size of the set
+template <typename T>
+void NextReactionSet<T>::change_total_weight(double variation)
+{
+    total_weight_ += variation;
+    weight_changes_++;
+    if (heap_.empty() or weight_changes_ >= std::max(heap_.size(),
+                TOTAL_WEIGHT_RESYNC_PERIOD))
+    {
+        total_weight_ = 0.;
+        for (const Reaction<T>& reaction : heap_)
+        {
+            total_weight_ += reaction.weight;
+        }
+        weight_changes_ = 0;
+    }
+}
+
+//get the weight of an element if it exists
+template <typename T>
+double NextReactionSet<T>::get_weight(const T& element) const
+{
+    auto iter = position_map_.find(element);
+    if (iter == position_map_.end())
+    {
+        std::string out = "Key error, the element is not in the set";
+        throw std::out_of_range(out);
+    }
+    return heap_[iter->second].weight;
+}
+
+//get the putative time of the next reaction
+template <typename T>
+double NextReactionSet<T>::next_time() const
+{
+    if (empty())
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    return heap_.front().time;
+}
+
+//fire the next reaction: the time is advanced to its putative time and a new
+//putative time is drawn for the reaction
+template <typename T>
+std::pair<T,double> NextReactionSet<T>::sample()
+{
+    if (empty())
+    {
+        std::string out = "The samplable set is empty";
+        throw std::out_of_range(out);
+    }
+    Reaction<T>& reaction = heap_.front();
+    time_ = reaction.time;
+    reaction.time = time_ + waiting_time_(gen_)/reaction.weight;
+    std::pair<T,double> element_weight_pair(reaction.element, reaction.weight);
+    sift_down(0);
+    return element_weight_pair;
+}
+
+//insert an element in the set with its associated weight
+//if the element is already there, do nothing
+template <typename T>
+void NextReactionSet<T>::insert(const T& element, double weight)
+{
+    weight_checkup(weight);
+    if (position_map_.find(element) == position_map_.end())
+    {
+        Reaction<T> reaction = {element, weight,
+            time_ + waiting_time_(gen_)/weight};
+        position_map_[element] = heap_.size();
+        heap_.push_back(reaction);
+        change_total_weight(weight);
+        sift_up(heap_.size()-1);
+    }
+}
+
+//set a new weight for the element in the set, its putative time is rescaled
+//if the element does not exists, same as insert
+template <typename T>
+void NextReactionSet<T>::set_weight(const T& element, double weight)
+{
+    weight_checkup(weight);
+    auto iter = position_map_.find(element);
+    if (iter != position_map_.end())
+    {
+        Reaction<T>& reaction = heap_[iter->second];
+        reaction.time = time_ +
+            (reaction.weight/weight)*(reaction.time - time_);
+        double variation = weight - reaction.weight;
+        reaction.weight = weight;
+        change_total_weight(variation);
+        update(iter->second);
+    }
+    else
+    {
+        insert(element, weight);
+    }
+}
+
+//Remove element from the set
+template <typename T>
+void NextReactionSet<T>::erase(const T& element)
+{
+    auto iter = position_map_.find(element);
+    if (iter != position_map_.end())
+    {
+        HeapIndex index = iter->second;
+        double weight = heap_[index].weight;
+        swap_nodes(index, heap_.size()-1);
+        position_map_.erase(element);
+        heap_.pop_back();
+        change_total_weight(-weight);
+        if (index < heap_.size())
+        {
+            update(index);
+        }
+    }
+}
+
+//advance the time without firing any reaction
+template <typename T>
+void NextReactionSet<T>::advance_time(double time)
+{
+    if (time < time_ or time > next_time())
+    {
+        throw std::invalid_argument("The time must be between the current "
+                "time and the time of the next reaction");
+    }
+    time_ = time;
+}
+
+//Remove all elements from the set
+template <typename T>
+void NextReactionSet<T>::clear()
+{
+    position_map_.clear();
+    heap_.clear();
+    total_weight_ = 0.;
+    weight_changes_ = 0;
+}
+
+}//end of namespace sset
+
+#endif /* NEXTREACTIONSET_HPP_ */
@@ -0,0 +1,124 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PYKEY_HPP_
+#define PYKEY_HPP_
+
+#include <pybind11/pybind11.h>
+#include <functional>
+
+namespace sset
+{//start of namespace sset
+
+/*
+ * Python object used as an element of a set. The hash is computed once by
+ * python and stored with the reference, and equality is python's __eq__.
+ * The GIL must be held when keys are copied, compared or destroyed.
+ */
+class PyKey
+{
+public:
+    PyKey() : object_(), hash_(0) {}
+    explicit PyKey(pybind11::object object) :
+        object_(object),
+        hash_(PyObject_Hash(object.ptr()))
+    {
+        if (hash_ == -1 and PyErr_Occurred())
+        {
+            throw pybind11::error_already_set();
+        }
+    }
+
+    const pybind11::object& object() const {return object_;}
+    Py_hash_t hash() const {return hash_;}
+
+    bool operator==(const PyKey& key) const
+    {
+        if (object_.is(key.object_))
+        {
+            return true;
+        }
+        if (hash_ != key.hash_)
+        {
+            return false;
+        }
+        int equal = PyObject_RichCompareBool(object_.ptr(), key.object_.ptr(),
+                Py_EQ);
+        if (equal == -1)
+        {
+            throw pybind11::error_already_set();
+        }
+        return equal == 1;
+    }
+
+private:
+    pybind11::object object_;
+    Py_hash_t hash_;
+};
+
+}//end of namespace sset
+
+namespace std
+{//start of namespace std
+
+//Hash specialization for python objects, using the stored hash
+template <>
+struct hash<sset::PyKey>
+{
+    size_t operator()(const sset::PyKey& key) const
+    {
+        return static_cast<size_t>(key.hash());
+    }
+};
+
+}//end of namespace std
+
+namespace pybind11
+{//start of namespace pybind11
+namespace detail
+{//start of namespace detail
+
+//Any python object is accepted as a key and returned as is
+template <>
+struct type_caster<sset::PyKey>
+{
+public:
+    PYBIND11_TYPE_CASTER(sset::PyKey, _("object"));
+
+    bool load(handle src, bool)
+    {
+        value = sset::PyKey(reinterpret_borrow<object>(src));
+        return true;
+    }
+
+    static handle cast(const sset::PyKey& key, return_value_policy, handle)
+    {
+        return key.object().inc_ref();
+    }
+};
+
+}//end of namespace detail
+}//end of namespace pybind11
+
+#endif /* PYKEY_HPP_ */
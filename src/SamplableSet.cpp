@@ -1,7 +1,9 @@
 #include "SamplableSet.hpp"
+#include <sstream>
 
 
 sset::RNGType sset::BaseSamplableSet::gen_ = RNGType(time(NULL));
+std::recursive_mutex sset::BaseSamplableSet::gen_mutex_;
 
 
 //seed the RNG
@@ -9,3 +11,37 @@ void sset::BaseSamplableSet::seed(unsigned int seed_value)
 {
     BaseSamplableSet::gen_.seed(seed_value);
 }
+
+//get the state of the RNG from its text representation
+sset::RNGState sset::BaseSamplableSet::rng_state()
+{
+    std::stringstream stream;
+    stream << BaseSamplableSet::gen_;
+    uint64_t multiplier;
+    RNGState state;
+    stream >> multiplier >> state.increment >> state.state;
+    return state;
+}
+
+//restore a state of the RNG, the increment of pcg streams is odd
+void sset::BaseSamplableSet::set_rng_state(const RNGState& state)
+{
+    if (state.increment % 2 == 0)
+    {
+        throw std::invalid_argument("Invalid RNG state, the increment must "
+                "be odd");
+    }
+    //the multiplier is a constant of the generator
+    std::stringstream current_stream;
+    current_stream << BaseSamplableSet::gen_;
+    uint64_t multiplier;
+    current_stream >> multiplier;
+    RNGType gen;
+    std::stringstream stream;
+    stream << multiplier << " " << state.increment << " " << state.state;
+    if (not (stream >> gen))
+    {
+        throw std::invalid_argument("Invalid RNG state");
+    }
+    BaseSamplableSet::gen_ = gen;
+}
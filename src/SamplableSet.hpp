@@ -27,14 +27,28 @@
 
 #include "HashPropensity.hpp"
 #include "BinaryTree.hpp"
+#include "Serializer.hpp"
+#include "Snapshot.hpp"
+#include "Journal.hpp"
+#include "Instrumentation.hpp"
+#include "MemoryUsage.hpp"
 #include "pcg-cpp/include/pcg_random.hpp"
 #include <utility>
 #include <random>
 #include <iostream>
+#include <fstream>
 #include <stdio.h>
 #include <time.h>
 #include <string>
 #include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <limits>
+#include <cmath>
 
 namespace sset
 {//start of namespace sset
@@ -42,15 +56,45 @@ namespace sset
 typedef unsigned int GroupIndex;
 typedef unsigned int InGroupIndex;
 typedef std::pair<GroupIndex, InGroupIndex> SSetPosition; //Set element Id
+typedef uint64_t LargeInGroupIndex; //for groups of more than 2^32 elements
 typedef pcg32 RNGType;
 
+//Full state of the RNG: the pcg state and the increment giving its stream
+struct RNGState
+{
+    uint64_t state;
+    uint64_t increment;
+};
+
+//Occupancy of the groups of a set, indexed by group
+struct GroupStats
+{
+    std::vector<std::size_t> size; //number of elements
+    std::vector<double> weight; //total weight, value of the leaf in the tree
+    std::vector<double> bound; //maximal weight used for rejection sampling
+    std::vector<double> acceptance; //mean weight over bound, nan if empty
+};
+
 //Base class to contain the shared RNG for derived template classes
+//The sets are not thread-safe; the locks are meant to be held by callers
+//sharing sets between threads, and are not copied with the set.
 class BaseSamplableSet
 {
     public:
+        BaseSamplableSet() : mutex_() {}
+        BaseSamplableSet(const BaseSamplableSet&) : mutex_() {}
+        BaseSamplableSet& operator=(const BaseSamplableSet&) {return *this;}
         static void seed(unsigned int seed_value);
+        static RNGState rng_state();
+        static void set_rng_state(const RNGState& state);
+        static std::recursive_mutex& rng_mutex() {return gen_mutex_;}
+        static RNGType& rng() {return gen_;}
+        std::recursive_mutex& mutex() const {return mutex_;}
     protected:
         static RNGType gen_;
+        static std::recursive_mutex gen_mutex_;
+    private:
+        mutable std::recursive_mutex mutex_;
 };
 
 
@@ -58,38 +102,124 @@ class BaseSamplableSet
  * Set of elements, samplable efficiently using composition and rejection
  * sampling.
  */
-template <class T>
+template <class T, class Index = InGroupIndex>
 class SamplableSet : public BaseSamplableSet
 {
 public:
     //Definition
     typedef std::vector<std::pair<T,double> > PropensityGroup;
+    typedef std::pair<GroupIndex, Index> Position;
+
+    //Iterator over the elements, skipping the empty groups
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<T,double> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const value_type* pointer;
+        typedef const value_type& reference;
+
+        const_iterator(const std::vector<PropensityGroup>* group_vector,
+                GroupIndex group_index) :
+            group_vector_(group_vector),
+            group_index_(group_index),
+            in_group_index_(0)
+            {skip_empty_groups();}
+
+        reference operator*() const
+            {return (*group_vector_)[group_index_][in_group_index_];}
+        pointer operator->() const
+            {return &(*group_vector_)[group_index_][in_group_index_];}
+        const_iterator& operator++()
+            {in_group_index_++; skip_empty_groups(); return *this;}
+        const_iterator operator++(int)
+            {const_iterator it(*this); ++(*this); return it;}
+        bool operator==(const const_iterator& it) const
+            {return group_index_ == it.group_index_ and
+                in_group_index_ == it.in_group_index_;}
+        bool operator!=(const const_iterator& it) const
+            {return not (*this == it);}
+
+    private:
+        const std::vector<PropensityGroup>* group_vector_;
+        GroupIndex group_index_;
+        Index in_group_index_;
+
+        void skip_empty_groups()
+        {
+            while (group_index_ < group_vector_->size() and
+                    in_group_index_ == (*group_vector_)[group_index_].size())
+            {
+                group_index_++;
+                in_group_index_ = 0;
+            }
+        }
+    };
 
     //Default constructor
     SamplableSet(double min_weight, double max_weight);
     //Copy constructor
-    SamplableSet(const SamplableSet<T>& s);
+    SamplableSet(const SamplableSet<T,Index>& s);
 
     //Accessors
     std::size_t size() const {return position_map_.size();}
     bool empty() const {return size() == 0;}
     std::size_t inline count(const T& element) const
-        {return position_map_.count(element);}
+        {count_probe(element); return position_map_.count(element);}
     std::pair<T,double> sample() const;
     template <typename ExtRNG>
     std::pair<T,double> sample_ext_RNG(ExtRNG& gen) const;
     double total_weight() const {return sampling_tree_.get_value();}
+    double min_weight() const {return min_weight_;}
+    double max_weight() const {return max_weight_;}
     double get_weight(const T& element) const;
+    bool find_weight(const T& element, double& weight) const;
+    std::size_t number_of_groups() const {return number_of_group_;}
+    const PropensityGroup& get_group(GroupIndex group_index) const
+        {return propensity_group_vector_.at(group_index);}
     std::pair<T,double> get_at_iterator() const;
+    const_iterator begin() const
+        {return const_iterator(&propensity_group_vector_, 0);}
+    const_iterator end() const
+        {return const_iterator(&propensity_group_vector_, number_of_group_);}
+    MemoryUsage memory_usage() const;
+    //number of insertions, erasures and clears, which invalidate iterators
+    uint64_t modification_count() const {return modification_count_;}
+    GroupStats group_stats() const;
+    std::vector<std::pair<T,unsigned long> > tau_leap(double tau) const;
+    double leap_size(double epsilon) const;
+    std::vector<std::pair<T,unsigned long> > sample_counts(
+            unsigned long n) const;
+    std::string serialize() const;
+    static SamplableSet<T,Index> deserialize(const std::string& buffer);
+    void save(const std::string& path, bool with_rng_state = false) const;
+    static SamplableSet<T,Index> load(const std::string& path);
 
     //Mutators
     void insert(const T& element, double weight = 0);
     void set_weight(const T& element, double weight);
+    bool update_weight(const T& element, double weight,
+            double& previous_weight);
+    bool try_insert(const T& element, double weight, double& current_weight);
     void erase(const T& element);
+    bool extract(const T& element, double& previous_weight);
     void next();
     void init_iterator();
     void clear();
 
+    //Journal of the modifications
+    void start_journal(const std::string& path,
+            std::size_t flush_size = JOURNAL_FLUSH_SIZE);
+    void flush_journal();
+    void stop_journal();
+    bool journaling() const {return bool(journal_);}
+    void replay(const std::string& path);
+
+    //Instrumentation counters, see Instrumentation.hpp
+    InstrumentationCounters counters() const;
+    void reset_counters();
+
 
 private:
     double min_weight_;
@@ -98,45 +228,69 @@ private:
     HashPropensity hash_;
     unsigned int number_of_group_;
     std::vector<double> max_propensity_vector_;
-    std::unordered_map<T,SSetPosition> position_map_;
+    typedef std::unordered_map<T,Position> PositionMap;
+    PositionMap position_map_;
     mutable BinaryTree sampling_tree_;
     std::vector<PropensityGroup> propensity_group_vector_;
     mutable typename PropensityGroup::iterator iterator_;
     mutable GroupIndex iterator_group_index_;
+    std::unique_ptr<JournalWriter> journal_;
+    bool batch_tree_updates_;
+    std::vector<double> pending_weight_vector_;
+    uint64_t modification_count_;
+#ifdef SAMPLABLESET_INSTRUMENTATION
+    mutable InstrumentationCounters counters_;
+#endif
     //private method
     void weight_checkup(double weight) const;
+    void count_probe(const T& element) const;
+    std::pair<typename PositionMap::iterator, bool> insert_unrecorded(
+            const T& element, double weight);
+    void erase_unrecorded(typename PositionMap::iterator position_iter);
+    void clear_unrecorded();
+    bool update_weight_unrecorded(const T& element, double weight,
+            double& previous_weight);
+    void update_group_weight(GroupIndex group_index, double variation);
+    void apply_pending_tree_updates();
+    void record(JournalOperation operation, const T& element,
+            double weight = 0)
+        {record(operation, element, weight, is_serializable<T>());}
+    void record(JournalOperation operation, const T& element, double weight,
+            std::true_type);
+    void record(JournalOperation, const T&, double, std::false_type) {}
+    template <class Flush>
+    void write_snapshot(std::string& buffer, Flush flush,
+            bool with_rng_state = false) const;
+    static SamplableSet<T,Index> read_snapshot(const char* data,
+            std::size_t data_size);
 };
 
 
 //Default constructor for the class SamplableSet
-template <typename T>
-SamplableSet<T>::SamplableSet(double min_weight, double max_weight) :
+template <typename T, typename Index>
+SamplableSet<T,Index>::SamplableSet(double min_weight, double max_weight) :
     min_weight_(min_weight),
     max_weight_(max_weight),
     random_01_(0.,1.),
     hash_(min_weight, max_weight),
     number_of_group_(hash_(max_weight)+1),
-    max_propensity_vector_(number_of_group_, 2*min_weight),
+    max_propensity_vector_(hash_.max_propensities()),
     position_map_(),
     sampling_tree_(number_of_group_),
     propensity_group_vector_(number_of_group_),
     iterator_(),
-    iterator_group_index_(0)
+    iterator_group_index_(0),
+    journal_(),
+    batch_tree_updates_(false),
+    pending_weight_vector_(),
+    modification_count_(0)
 {
-    //Initialize max propensity vector
-    if (number_of_group_ > 2)
-    {
-        for (unsigned int i = 0; i < number_of_group_-2; i++)
-        {
-            max_propensity_vector_[i+1] = max_propensity_vector_[i]*2;
-        }
-    }
-    max_propensity_vector_.back() = max_weight;
 }
 
 //Copy constructor
-template <typename T>
-SamplableSet<T>::SamplableSet(const SamplableSet<T>& s) :
+template <typename T, typename Index>
+SamplableSet<T,Index>::SamplableSet(const SamplableSet<T,Index>& s) :
+    BaseSamplableSet(s),
     min_weight_(s.min_weight_),
     max_weight_(s.max_weight_),
     random_01_(0.,1.),
@@ -147,15 +301,19 @@ SamplableSet<T>::SamplableSet(const SamplableSet<T>& s) :
     sampling_tree_(s.sampling_tree_),
     propensity_group_vector_(s.propensity_group_vector_),
     iterator_(),
-    iterator_group_index_(0)
+    iterator_group_index_(0),
+    journal_(),
+    batch_tree_updates_(false),
+    pending_weight_vector_(),
+    modification_count_(0)
 {
 }
 
 //throw a invalid_argument error if the weight is out of bounds
-template <typename T>
-void SamplableSet<T>::weight_checkup(double weight) const
+template <typename T, typename Index>
+void SamplableSet<T,Index>::weight_checkup(double weight) const
 {
-    if (weight < min_weight_ or weight > max_weight_)
+    if (not (weight >= min_weight_ and weight <= max_weight_))
     {
         std::string out = "Weight " + std::to_string(weight) + " out of bounds [" +
             std::to_string(min_weight_) + "," + std::to_string(max_weight_) + "]";
@@ -164,17 +322,19 @@ void SamplableSet<T>::weight_checkup(double weight) const
 }
 
 //sample an element according to its weight
-template <typename T>
-std::pair<T,double> SamplableSet<T>::sample() const
+template <typename T, typename Index>
+std::pair<T,double> SamplableSet<T,Index>::sample() const
 {
     GroupIndex group_index;
-    InGroupIndex in_group_index;
+    Index in_group_index;
     if (not empty())
     {
         group_index = sampling_tree_.get_leaf_index(random_01_(gen_));
+        SSET_INSTRUMENT(counters_.samples++;)
         bool element_not_chosen = true;
         while (element_not_chosen)
         {
+            SSET_INSTRUMENT(counters_.rejection_trials++;)
             in_group_index = floor(random_01_(gen_)*propensity_group_vector_.at(
                         group_index).size());
 
@@ -197,18 +357,20 @@ std::pair<T,double> SamplableSet<T>::sample() const
 }
 
 //sample an element according to its weight using an external RNG
-template <typename T>
+template <typename T, typename Index>
 template <typename ExtRNG>
-std::pair<T,double>SamplableSet<T>::sample_ext_RNG(ExtRNG& gen) const
+std::pair<T,double>SamplableSet<T,Index>::sample_ext_RNG(ExtRNG& gen) const
 {
     GroupIndex group_index;
-    InGroupIndex in_group_index;
+    Index in_group_index;
     if (not empty())
     {
         group_index = sampling_tree_.get_leaf_index(random_01_(gen));
+        SSET_INSTRUMENT(counters_.samples++;)
         bool element_not_chosen = true;
         while (element_not_chosen)
         {
+            SSET_INSTRUMENT(counters_.rejection_trials++;)
             in_group_index = floor(random_01_(gen)*propensity_group_vector_.at(
                         group_index).size());
 
@@ -230,14 +392,448 @@ std::pair<T,double>SamplableSet<T>::sample_ext_RNG(ExtRNG& gen) const
     return propensity_group_vector_.at(group_index).at(in_group_index);
 }
 
+//draw the number of times each element fires during tau, the elements
+//firing with rates equal to their weights
+//returns the elements that fired at least once with their count
+template <typename T, typename Index>
+std::vector<std::pair<T,unsigned long> > SamplableSet<T,Index>::tau_leap(
+        double tau) const
+{
+    if (not (tau >= 0) or std::isinf(tau))
+    {
+        throw std::invalid_argument("The leap " + std::to_string(tau)
+                + " is not a finite nonnegative duration");
+    }
+    std::vector<std::pair<T,unsigned long> > firing_vector;
+    if (tau == 0)
+    {
+        return firing_vector;
+    }
+    for (GroupIndex group_index = 0; group_index < number_of_group_;
+            group_index++)
+    {
+        const PropensityGroup& group = propensity_group_vector_[group_index];
+        if (group.empty())
+        {
+            continue;
+        }
+        double max_propensity = max_propensity_vector_[group_index];
+        double mean_candidates = tau*max_propensity*group.size();
+        if (mean_candidates < group.size())
+        {
+            //thinning: candidate events are uniformly distributed among the
+            //elements and accepted with probability weight/max_propensity
+            std::poisson_distribution<unsigned long> poisson(mean_candidates);
+            unsigned long n_candidates = poisson(gen_);
+            std::vector<Index> accepted_vector;
+            for (unsigned long i = 0; i < n_candidates; i++)
+            {
+                Index in_group_index = floor(
+                        random_01_(gen_)*group.size());
+                if (random_01_(gen_) <
+                        group[in_group_index].second/max_propensity)
+                {
+                    accepted_vector.push_back(in_group_index);
+                }
+            }
+            std::sort(accepted_vector.begin(), accepted_vector.end());
+            for (std::size_t i = 0; i < accepted_vector.size(); i++)
+            {
+                if (i == 0 or accepted_vector[i] != accepted_vector[i-1])
+                {
+                    firing_vector.push_back(std::make_pair(
+                                group[accepted_vector[i]].first, 0));
+                }
+                firing_vector.back().second += 1;
+            }
+        }
+        else
+        {
+            //draw the count of each element
+            for (const auto& element_weight_pair : group)
+            {
+                std::poisson_distribution<unsigned long> poisson(
+                        tau*element_weight_pair.second);
+                unsigned long n_firings = poisson(gen_);
+                if (n_firings > 0)
+                {
+                    firing_vector.push_back(std::make_pair(
+                                element_weight_pair.first, n_firings));
+                }
+            }
+        }
+    }
+    return firing_vector;
+}
+
+//leap size for which the expected number of firings of each element is at
+//most epsilon
+template <typename T, typename Index>
+double SamplableSet<T,Index>::leap_size(double epsilon) const
+{
+    if (not (epsilon > 0) or std::isinf(epsilon))
+    {
+        throw std::invalid_argument("The expected number of firings "
+                + std::to_string(epsilon) + " is not finite and positive");
+    }
+    double max_propensity = 0;
+    for (GroupIndex group_index = 0; group_index < number_of_group_;
+            group_index++)
+    {
+        if (not propensity_group_vector_[group_index].empty())
+        {
+            max_propensity = max_propensity_vector_[group_index];
+        }
+    }
+    if (max_propensity == 0)
+    {
+        std::string out = "The samplable set is empty";
+        throw std::out_of_range(out);
+    }
+    return epsilon/max_propensity;
+}
+
+//draw n elements with replacement according to their weights
+//returns the elements drawn at least once with their count
+template <typename T, typename Index>
+std::vector<std::pair<T,unsigned long> > SamplableSet<T,Index>::sample_counts(
+        unsigned long n) const
+{
+    std::vector<std::pair<T,unsigned long> > count_vector;
+    if (n > 0 and empty())
+    {
+        std::string out = "The samplable set is empty";
+        throw std::out_of_range(out);
+    }
+    SSET_INSTRUMENT(counters_.samples += n;)
+    std::vector<unsigned long> group_count_vector =
+        sampling_tree_.get_leaf_counts(n, gen_);
+    for (GroupIndex group_index = 0; group_index < number_of_group_;
+            group_index++)
+    {
+        const PropensityGroup& group = propensity_group_vector_[group_index];
+        unsigned long group_count = group_count_vector[group_index];
+        if (group_count == 0)
+        {
+            continue;
+        }
+        if (group_count < group.size())
+        {
+            //few draws: use the rejection scheme for each draw
+            std::vector<Index> drawn_vector;
+            drawn_vector.reserve(group_count);
+            while (drawn_vector.size() < group_count)
+            {
+                SSET_INSTRUMENT(counters_.rejection_trials++;)
+                Index in_group_index = floor(
+                        random_01_(gen_)*group.size());
+                if (random_01_(gen_) < group[in_group_index].second/(
+                            max_propensity_vector_[group_index]))
+                {
+                    drawn_vector.push_back(in_group_index);
+                }
+            }
+            std::sort(drawn_vector.begin(), drawn_vector.end());
+            for (std::size_t i = 0; i < drawn_vector.size(); i++)
+            {
+                if (i == 0 or drawn_vector[i] != drawn_vector[i-1])
+                {
+                    count_vector.push_back(std::make_pair(
+                                group[drawn_vector[i]].first, 0));
+                }
+                count_vector.back().second += 1;
+            }
+        }
+        else
+        {
+            //many draws: conditional binomial draws for each element
+            double remaining_weight = 0;
+            for (const auto& element_weight_pair : group)
+            {
+                remaining_weight += element_weight_pair.second;
+            }
+            for (std::size_t i = 0; i < group.size(); i++)
+            {
+                const auto& element_weight_pair = group[i];
+                //the last element gets the draws left by rounding errors
+                unsigned long element_count = group_count;
+                if (i + 1 < group.size())
+                {
+                    double p = std::min(
+                            element_weight_pair.second/remaining_weight, 1.);
+                    element_count = binomial(group_count, p, gen_);
+                }
+                if (element_count > 0)
+                {
+                    count_vector.push_back(std::make_pair(
+                                element_weight_pair.first, element_count));
+                }
+                group_count -= element_count;
+                remaining_weight -= element_weight_pair.second;
+                if (group_count == 0)
+                {
+                    break;
+                }
+            }
+        }
+    }
+    return count_vector;
+}
+
+//write the set in the snapshot format, flush is called on the buffer
+//whenever it holds a full chunk ending at an aligned position
+template <typename T, typename Index>
+template <class Flush>
+void SamplableSet<T,Index>::write_snapshot(std::string& buffer,
+        Flush flush, bool with_rng_state) const
+{
+    SnapshotHeader header;
+    header.version = SNAPSHOT_VERSION;
+    header.flags = with_rng_state ? SNAPSHOT_RNG_STATE : 0;
+    RNGState state = with_rng_state ? rng_state() : RNGState{0, 0};
+    header.rng_state = state.state;
+    header.rng_increment = state.increment;
+    header.signature = Serializer<T>::signature();
+    header.min_weight = min_weight_;
+    header.max_weight = max_weight_;
+    header.number_of_groups = number_of_group_;
+    header.size = size();
+    header.group_weight_vector.assign(number_of_group_, 0.);
+    for (GroupIndex group_index = 0; group_index < number_of_group_;
+            group_index++)
+    {
+        for (const auto& element_weight_pair :
+                propensity_group_vector_[group_index])
+        {
+            header.group_weight_vector[group_index] +=
+                element_weight_pair.second;
+        }
+    }
+    header.write(buffer);
+    auto flush_chunk = [&buffer, &flush]()
+    {
+        if (buffer.size() >= SNAPSHOT_CHUNK_SIZE and
+                buffer.size() % SNAPSHOT_ALIGNMENT == 0)
+        {
+            flush(buffer);
+        }
+    };
+    for (const auto& group : propensity_group_vector_)
+    {
+        Serializer<uint64_t>::write(group.size(), buffer);
+        for (const auto& element_weight_pair : group)
+        {
+            Serializer<double>::write(element_weight_pair.second, buffer);
+            flush_chunk();
+        }
+        for (const auto& element_weight_pair : group)
+        {
+            Serializer<T>::write(element_weight_pair.first, buffer);
+        }
+        pad_snapshot(buffer);
+        flush_chunk();
+    }
+    flush(buffer);
+}
+
+//rebuild a set from a snapshot
+//the elements are put back in their groups and the tree is built from the
+//stored group weights, without any weight being hashed again
+//the shared RNG is restored if its state was saved
+template <typename T, typename Index>
+SamplableSet<T,Index> SamplableSet<T,Index>::read_snapshot(const char* data,
+        std::size_t data_size)
+{
+    const char* cursor = data;
+    const char* end = data + data_size;
+    SnapshotHeader header = SnapshotHeader::read(cursor, data, end);
+    if (header.signature != Serializer<T>::signature())
+    {
+        throw std::invalid_argument("Snapshot of elements of type "
+                + header.signature + " instead of "
+                + Serializer<T>::signature());
+    }
+    SamplableSet<T,Index> set(header.min_weight, header.max_weight);
+    if (header.number_of_groups != set.number_of_group_)
+    {
+        throw std::invalid_argument("Inconsistent number of groups");
+    }
+    //each element takes at least the bytes of its weight
+    set.position_map_.reserve(std::min<uint64_t>(header.size,
+                static_cast<uint64_t>(end - cursor)/sizeof(double)));
+    uint64_t total_size = 0;
+    for (GroupIndex group_index = 0; group_index < set.number_of_group_;
+            group_index++)
+    {
+        PropensityGroup& group = set.propensity_group_vector_[group_index];
+        uint64_t group_size = Serializer<uint64_t>::read(cursor, end);
+        if (static_cast<uint64_t>(end - cursor)/sizeof(double) < group_size)
+        {
+            throw std::invalid_argument("Truncated serialized data");
+        }
+        group.resize(group_size);
+        double weight_sum = 0.;
+        for (auto& element_weight_pair : group)
+        {
+            double weight = Serializer<double>::read(cursor, end);
+            set.weight_checkup(weight);
+            if (set.hash_(weight) != group_index)
+            {
+                throw std::invalid_argument(
+                        "Weight in the wrong group of the serialized set");
+            }
+            element_weight_pair.second = weight;
+            weight_sum += weight;
+        }
+        //the tree is built from the weights of the elements, summed in the
+        //same order as when the snapshot was written
+        check_snapshot_group_weight(header.group_weight_vector[group_index],
+                weight_sum);
+        header.group_weight_vector[group_index] = weight_sum;
+        for (uint64_t i = 0; i < group_size; i++)
+        {
+            group[i].first = Serializer<T>::read(cursor, end);
+            if (not set.position_map_.emplace(group[i].first,
+                        Position(group_index, i)).second)
+            {
+                throw std::invalid_argument(
+                        "Duplicate element in the serialized set");
+            }
+        }
+        skip_snapshot_padding(cursor, data, end);
+        total_size += group_size;
+    }
+    if (cursor != end)
+    {
+        throw std::invalid_argument(
+                "Unexpected data after the serialized set");
+    }
+    if (total_size != header.size)
+    {
+        throw std::invalid_argument("Inconsistent size of the snapshot");
+    }
+    set.sampling_tree_.set_leaf_values(header.group_weight_vector);
+    if (header.flags & SNAPSHOT_RNG_STATE)
+    {
+        set_rng_state(RNGState{header.rng_state, header.rng_increment});
+    }
+    return set;
+}
+
+//pack the set in a binary string
+template <typename T, typename Index>
+std::string SamplableSet<T,Index>::serialize() const
+{
+    std::string buffer;
+    write_snapshot(buffer, [](std::string&) {});
+    return buffer;
+}
+
+//rebuild a set from the output of serialize
+template <typename T, typename Index>
+SamplableSet<T,Index> SamplableSet<T,Index>::deserialize(
+        const std::string& buffer)
+{
+    return read_snapshot(buffer.data(), buffer.size());
+}
+
+//write a snapshot of the set in a file, chunk by chunk
+template <typename T, typename Index>
+void SamplableSet<T,Index>::save(const std::string& path,
+        bool with_rng_state) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (not file)
+    {
+        throw std::runtime_error("Cannot open " + path + " for writing");
+    }
+    std::string buffer;
+    buffer.reserve(SNAPSHOT_CHUNK_SIZE + SNAPSHOT_ALIGNMENT);
+    write_snapshot(buffer, [&file, &path](std::string& chunk)
+        {
+            if (not file.write(chunk.data(), chunk.size()))
+            {
+                throw std::runtime_error("Cannot write to " + path);
+            }
+            chunk.clear();
+        }, with_rng_state);
+    file.close();
+    if (not file)
+    {
+        throw std::runtime_error("Cannot write to " + path);
+    }
+}
+
+//load a set from a snapshot file
+template <typename T, typename Index>
+SamplableSet<T,Index> SamplableSet<T,Index>::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (not file)
+    {
+        throw std::runtime_error("Cannot open " + path + " for reading");
+    }
+    std::string buffer(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    if (not file.read(&buffer[0], buffer.size()))
+    {
+        throw std::runtime_error("Cannot read " + path);
+    }
+    return read_snapshot(buffer.data(), buffer.size());
+}
+
+//bytes used by the components of the set
+template <typename T, typename Index>
+MemoryUsage SamplableSet<T,Index>::memory_usage() const
+{
+    MemoryUsage usage;
+    usage.object = sizeof(*this);
+    usage.position_map_buckets = hash_map_bucket_bytes(position_map_);
+    usage.position_map_nodes = hash_map_node_bytes(position_map_);
+    for (const PropensityGroup& group : propensity_group_vector_)
+    {
+        usage.group_elements += group.size()*sizeof(std::pair<T,double>);
+        usage.group_slack += (group.capacity() - group.size())
+            *sizeof(std::pair<T,double>);
+    }
+    usage.group_vectors = propensity_group_vector_.capacity()
+        *sizeof(PropensityGroup) + (max_propensity_vector_.capacity()
+        + pending_weight_vector_.capacity())*sizeof(double);
+    usage.tree_nodes = sampling_tree_.node_bytes();
+    usage.tree_leaves = sampling_tree_.leaf_index_bytes();
+    return usage;
+}
+
+//size, weight, bound and expected acceptance ratio of each group
+template <typename T, typename Index>
+GroupStats SamplableSet<T,Index>::group_stats() const
+{
+    GroupStats stats;
+    for (GroupIndex group_index = 0; group_index < number_of_group_;
+            group_index++)
+    {
+        std::size_t group_size = propensity_group_vector_[group_index].size();
+        double weight = sampling_tree_.get_leaf_value(group_index);
+        double bound = max_propensity_vector_[group_index];
+        stats.size.push_back(group_size);
+        stats.weight.push_back(weight);
+        stats.bound.push_back(bound);
+        stats.acceptance.push_back(group_size == 0 ?
+                std::numeric_limits<double>::quiet_NaN() :
+                weight/(group_size*bound));
+    }
+    return stats;
+}
+
 //get the weight of an element if it exists
-template <typename T>
-double SamplableSet<T>::get_weight(const T& element) const
+template <typename T, typename Index>
+double SamplableSet<T,Index>::get_weight(const T& element) const
 {
     double weight;
     if(count(element))
     {
-        const SSetPosition& position = position_map_.at(element);
+        count_probe(element);
+        const Position& position = position_map_.at(element);
         weight = (propensity_group_vector_[position.first][position.second]).second;
     }
      else
@@ -249,61 +845,121 @@ double SamplableSet<T>::get_weight(const T& element) const
     return weight;
 }
 
+//give the weight of an element with a single lookup
+//returns false if the element is not in the set
+template <typename T, typename Index>
+bool SamplableSet<T,Index>::find_weight(const T& element, double& weight) const
+{
+    count_probe(element);
+    auto iter = position_map_.find(element);
+    if (iter == position_map_.end())
+    {
+        return false;
+    }
+    const Position& position = iter->second;
+    weight = propensity_group_vector_[position.first][position.second].second;
+    return true;
+}
+
 //insert an element in the set with its associated weight
 //if the element is already there, do nothing
-template <typename T>
-void SamplableSet<T>::insert(const T& element, double weight)
+template <typename T, typename Index>
+void SamplableSet<T,Index>::insert(const T& element, double weight)
+{
+    double current_weight;
+    try_insert(element, weight, current_weight);
+}
+
+//insert an element absent from the set and return true
+//if the element is already there, give its weight and return false
+template <typename T, typename Index>
+bool SamplableSet<T,Index>::try_insert(const T& element, double weight,
+        double& current_weight)
 {
     weight_checkup(weight);
-    //insert element only if not present
-    if (position_map_.find(element) == position_map_.end())
+    auto result = insert_unrecorded(element, weight);
+    if (not result.second)
     {
-        GroupIndex group_index = hash_(weight);
-        InGroupIndex in_group_index =
-            propensity_group_vector_[group_index].size();
-        propensity_group_vector_[group_index].push_back(
-                std::make_pair(element,weight));
-        position_map_[element] = SSetPosition(group_index, in_group_index);
-        sampling_tree_.update_value(group_index, weight);
+        const Position& position = result.first->second;
+        current_weight =
+            propensity_group_vector_[position.first][position.second].second;
+        return false;
     }
+    record(JOURNAL_INSERT, element, weight);
+    return true;
 }
 
 //set a new weight for the element in the set
 //if the element does not exists, same as insert
-template <typename T>
-void SamplableSet<T>::set_weight(const T& element, double weight)
+template <typename T, typename Index>
+void SamplableSet<T,Index>::set_weight(const T& element, double weight)
 {
     weight_checkup(weight);
-    erase(element);
-    insert(element, weight);
+    double previous_weight;
+    if (not update_weight_unrecorded(element, weight, previous_weight))
+    {
+        insert_unrecorded(element, weight);
+    }
+    record(JOURNAL_SET_WEIGHT, element, weight);
+}
+
+//set a new weight for an element of the set and give its previous weight
+//returns false and does nothing if the element is not in the set
+template <typename T, typename Index>
+bool SamplableSet<T,Index>::update_weight(const T& element, double weight,
+        double& previous_weight)
+{
+    weight_checkup(weight);
+    if (not update_weight_unrecorded(element, weight, previous_weight))
+    {
+        return false;
+    }
+    record(JOURNAL_SET_WEIGHT, element, weight);
+    return true;
 }
 
 //Remove element from the set
-template <typename T>
-void SamplableSet<T>::erase(const T& element)
+template <typename T, typename Index>
+void SamplableSet<T,Index>::erase(const T& element)
+{
+    double previous_weight;
+    extract(element, previous_weight);
+}
+
+//remove an element from the set and give its weight
+//returns false and does nothing if the element is not in the set
+template <typename T, typename Index>
+bool SamplableSet<T,Index>::extract(const T& element, double& previous_weight)
 {
-    //remove element if present
-    if (count(element))
+    count_probe(element);
+    auto iter = position_map_.find(element);
+    if (iter == position_map_.end())
     {
-        const SSetPosition& position = position_map_.at(element);
-        //create alias for element and its weight pair
-        std::pair<T, double>& element_weight_pair =
-            propensity_group_vector_[position.first][position.second];
-        sampling_tree_.update_value(position.first, -element_weight_pair.second);
-        //gives position to last element of propensity group and swap
-        position_map_[
-            (propensity_group_vector_[position.first].back()).first] = position;
-        std::swap(element_weight_pair,
-                propensity_group_vector_[position.first].back());
-        //remove
-        propensity_group_vector_[position.first].pop_back();
-        position_map_.erase(element);
+        return false;
     }
+    const Position& position = iter->second;
+    previous_weight =
+        propensity_group_vector_[position.first][position.second].second;
+    erase_unrecorded(iter);
+    record(JOURNAL_ERASE, element);
+    return true;
 }
 
 //Remove all elements from the set
-template <typename T>
-void SamplableSet<T>::clear()
+template <typename T, typename Index>
+void SamplableSet<T,Index>::clear()
+{
+    clear_unrecorded();
+    if (journal_)
+    {
+        journal_->buffer().push_back(static_cast<char>(JOURNAL_CLEAR));
+        journal_->commit();
+    }
+}
+
+//remove all elements, without journal entry
+template <typename T, typename Index>
+void SamplableSet<T,Index>::clear_unrecorded()
 {
     sampling_tree_.clear();
     position_map_.clear();
@@ -312,13 +968,275 @@ void SamplableSet<T>::clear()
     {
         group_vector.clear();
     }
+    std::fill(pending_weight_vector_.begin(), pending_weight_vector_.end(),
+            0.);
+    modification_count_++;
 }
 
+//insert an element if it is absent, without journal entry
+//returns the position of the element in the map and true if it was inserted
+//the lookup is done before the set is modified
+template <typename T, typename Index>
+std::pair<typename SamplableSet<T,Index>::PositionMap::iterator, bool>
+SamplableSet<T,Index>::insert_unrecorded(const T& element, double weight)
+{
+    GroupIndex group_index = hash_(weight);
+    PropensityGroup& group = propensity_group_vector_[group_index];
+    count_probe(element);
+    auto result = position_map_.emplace(element,
+            Position(group_index, group.size()));
+    if (result.second)
+    {
+        try
+        {
+            group.push_back(std::make_pair(element, weight));
+        }
+        catch (...)
+        {
+            position_map_.erase(result.first);
+            throw;
+        }
+        update_group_weight(group_index, weight);
+        modification_count_++;
+    }
+    return result;
+}
 
+//set the weight of an element if present, without journal entry
+template <typename T, typename Index>
+bool SamplableSet<T,Index>::update_weight_unrecorded(const T& element,
+        double weight, double& previous_weight)
+{
+    count_probe(element);
+    auto iter = position_map_.find(element);
+    if (iter == position_map_.end())
+    {
+        return false;
+    }
+    const Position& position = iter->second;
+    std::pair<T, double>& element_weight_pair =
+        propensity_group_vector_[position.first][position.second];
+    previous_weight = element_weight_pair.second;
+    if (hash_(weight) == position.first)
+    {
+        //the element stays in the same group, update its weight in place
+        update_group_weight(position.first, weight - previous_weight);
+        element_weight_pair.second = weight;
+    }
+    else
+    {
+        SSET_INSTRUMENT(counters_.group_changes++;)
+        erase_unrecorded(iter);
+        insert_unrecorded(element, weight);
+    }
+    return true;
+}
+
+//remove the element found in the position map, without journal entry
+//the lookups are done before the set is modified
+template <typename T, typename Index>
+void SamplableSet<T,Index>::erase_unrecorded(
+        typename PositionMap::iterator position_iter)
+{
+    const Position position = position_iter->second;
+    PropensityGroup& group = propensity_group_vector_[position.first];
+    //the last element of the group takes the position of the element
+    typename PositionMap::iterator last_iter = position_iter;
+    if (position.second + 1 != group.size())
+    {
+        count_probe(group.back().first);
+        last_iter = position_map_.find(group.back().first);
+    }
+    update_group_weight(position.first, -group[position.second].second);
+    last_iter->second = position;
+    std::swap(group[position.second], group.back());
+    group.pop_back();
+    position_map_.erase(position_iter);
+    modification_count_++;
+}
+
+//count the buckets and nodes read by a lookup in the position map
+template <typename T, typename Index>
+void SamplableSet<T,Index>::count_probe(const T& element) const
+{
+#ifdef SAMPLABLESET_INSTRUMENTATION
+    std::size_t bucket_nodes = position_map_.bucket_count() == 0 ? 0 :
+        position_map_.bucket_size(position_map_.bucket(element));
+    counters_.hash_probes += 1 + bucket_nodes;
+#else
+    (void) element;
+#endif
+}
+
+//get the counters, the tree visits are counted by the tree
+template <typename T, typename Index>
+InstrumentationCounters SamplableSet<T,Index>::counters() const
+{
+    InstrumentationCounters counters;
+#ifdef SAMPLABLESET_INSTRUMENTATION
+    counters = counters_;
+    counters.tree_node_visits = sampling_tree_.node_visits();
+#endif
+    return counters;
+}
+
+template <typename T, typename Index>
+void SamplableSet<T,Index>::reset_counters()
+{
+    SSET_INSTRUMENT(counters_ = InstrumentationCounters();)
+    sampling_tree_.reset_node_visits();
+}
+
+//change the total weight of a group in the tree, or accumulate the change
+//while a journal is replayed
+template <typename T, typename Index>
+void SamplableSet<T,Index>::update_group_weight(GroupIndex group_index,
+        double variation)
+{
+    if (batch_tree_updates_)
+    {
+        pending_weight_vector_[group_index] += variation;
+    }
+    else
+    {
+        sampling_tree_.update_value(group_index, variation);
+    }
+}
+
+template <typename T, typename Index>
+void SamplableSet<T,Index>::apply_pending_tree_updates()
+{
+    batch_tree_updates_ = false;
+    for (GroupIndex group_index = 0; group_index < number_of_group_;
+            group_index++)
+    {
+        if (pending_weight_vector_[group_index] != 0.)
+        {
+            sampling_tree_.update_value(group_index,
+                    pending_weight_vector_[group_index]);
+        }
+    }
+    pending_weight_vector_.clear();
+}
+
+//append an entry to the journal if there is one
+template <typename T, typename Index>
+void SamplableSet<T,Index>::record(JournalOperation operation,
+        const T& element, double weight, std::true_type)
+{
+    if (journal_)
+    {
+        std::string& buffer = journal_->buffer();
+        buffer.push_back(static_cast<char>(operation));
+        Serializer<T>::write(element, buffer);
+        if (operation == JOURNAL_INSERT or operation == JOURNAL_SET_WEIGHT)
+        {
+            Serializer<double>::write(weight, buffer);
+        }
+        journal_->commit();
+    }
+}
+
+//record the following modifications in a new journal file
+template <typename T, typename Index>
+void SamplableSet<T,Index>::start_journal(const std::string& path,
+        std::size_t flush_size)
+{
+    journal_.reset(new JournalWriter(path, Serializer<T>::signature(),
+                flush_size));
+}
+
+template <typename T, typename Index>
+void SamplableSet<T,Index>::flush_journal()
+{
+    if (journal_)
+    {
+        journal_->flush();
+    }
+}
+
+//flush and close the journal
+template <typename T, typename Index>
+void SamplableSet<T,Index>::stop_journal()
+{
+    if (journal_)
+    {
+        journal_->flush();
+        journal_.reset();
+    }
+}
+
+//apply the modifications of a journal
+//the tree is updated once per group at the end instead of after each entry
+//the entries are not recorded again in the journal of the set, if any
+template <typename T, typename Index>
+void SamplableSet<T,Index>::replay(const std::string& path)
+{
+    std::string data = read_journal_file(path);
+    const char* cursor = data.data();
+    const char* end = data.data() + data.size();
+    std::string signature = read_journal_header(cursor, end);
+    if (signature != Serializer<T>::signature())
+    {
+        throw std::invalid_argument("Journal of elements of type "
+                + signature + " instead of " + Serializer<T>::signature());
+    }
+    batch_tree_updates_ = true;
+    pending_weight_vector_.assign(number_of_group_, 0.);
+    try
+    {
+        while (cursor != end)
+        {
+            uint8_t operation = Serializer<uint8_t>::read(cursor, end);
+            if (operation == JOURNAL_CLEAR)
+            {
+                clear_unrecorded();
+                continue;
+            }
+            T element = Serializer<T>::read(cursor, end);
+            double weight;
+            double previous_weight;
+            typename PositionMap::iterator iter;
+            switch (operation)
+            {
+                case JOURNAL_INSERT:
+                    weight = Serializer<double>::read(cursor, end);
+                    weight_checkup(weight);
+                    insert_unrecorded(element, weight);
+                    break;
+                case JOURNAL_SET_WEIGHT:
+                    weight = Serializer<double>::read(cursor, end);
+                    weight_checkup(weight);
+                    if (not update_weight_unrecorded(element, weight,
+                                previous_weight))
+                    {
+                        insert_unrecorded(element, weight);
+                    }
+                    break;
+                case JOURNAL_ERASE:
+                    count_probe(element);
+                    iter = position_map_.find(element);
+                    if (iter != position_map_.end())
+                    {
+                        erase_unrecorded(iter);
+                    }
+                    break;
+                default:
+                    throw std::invalid_argument("Unknown journal operation");
+            }
+        }
+    }
+    catch (...)
+    {
+        apply_pending_tree_updates();
+        throw;
+    }
+    apply_pending_tree_updates();
+}
 
 
-template <typename T>
-void SamplableSet<T>::next()
+template <typename T, typename Index>
+void SamplableSet<T,Index>::next()
 {
     if (iterator_ != propensity_group_vector_.back().end())
     {
@@ -339,8 +1257,8 @@ void SamplableSet<T>::next()
     }
 }
 
-template <typename T>
-std::pair<T,double> SamplableSet<T>::get_at_iterator() const
+template <typename T, typename Index>
+std::pair<T,double> SamplableSet<T,Index>::get_at_iterator() const
 {
     if (iterator_ == (propensity_group_vector_.back()).end())
     {
@@ -351,8 +1269,8 @@ std::pair<T,double> SamplableSet<T>::get_at_iterator() const
     return *iterator_;
 }
 
-template <typename T>
-void SamplableSet<T>::init_iterator()
+template <typename T, typename Index>
+void SamplableSet<T,Index>::init_iterator()
 {
     iterator_group_index_ = 0;
     iterator_ = propensity_group_vector_[0].begin();
@@ -0,0 +1,209 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERIALIZER_HPP_
+#define SERIALIZER_HPP_
+
+#include <string>
+#include <tuple>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+
+namespace sset
+{//start of namespace sset
+
+//true if the bytes of numbers are stored from the least significant
+inline bool little_endian_host()
+{
+    const uint16_t one = 1;
+    return *reinterpret_cast<const char*>(&one) == 1;
+}
+
+//Packed little-endian binary representation of the elements of a set.
+//Values are appended to a buffer and read back from a cursor that is
+//advanced past them. The signature identifies the type in snapshots, and
+//fixed_size is the number of bytes of the values of fixed-size types.
+template <typename T, typename Enable = void>
+struct Serializer;
+
+//arithmetic types are copied byte by byte
+template <typename T>
+struct Serializer<T,
+    typename std::enable_if<std::is_arithmetic<T>::value>::type>
+{
+    static constexpr std::size_t fixed_size() {return sizeof(T);}
+
+    static std::string signature()
+    {
+        char kind = std::is_floating_point<T>::value ? 'f' :
+            (std::is_signed<T>::value ? 'i' : 'u');
+        return kind + std::to_string(sizeof(T));
+    }
+
+    static void write(const T& value, std::string& buffer)
+    {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        if (not little_endian_host())
+        {
+            std::reverse(bytes, bytes + sizeof(T));
+        }
+        buffer.append(bytes, sizeof(T));
+    }
+
+    static T read(const char*& cursor, const char* end)
+    {
+        if (end - cursor < static_cast<std::ptrdiff_t>(sizeof(T)))
+        {
+            throw std::invalid_argument("Truncated serialized data");
+        }
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, cursor, sizeof(T));
+        if (not little_endian_host())
+        {
+            std::reverse(bytes, bytes + sizeof(T));
+        }
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        cursor += sizeof(T);
+        return value;
+    }
+};
+
+//strings are preceded by their length
+template <>
+struct Serializer<std::string>
+{
+    static std::string signature() {return "s";}
+
+    static void write(const std::string& value, std::string& buffer)
+    {
+        Serializer<uint64_t>::write(value.size(), buffer);
+        buffer.append(value);
+    }
+
+    static std::string read(const char*& cursor, const char* end)
+    {
+        uint64_t length = Serializer<uint64_t>::read(cursor, end);
+        if (static_cast<uint64_t>(end - cursor) < length)
+        {
+            throw std::invalid_argument("Truncated serialized data");
+        }
+        std::string value(cursor, length);
+        cursor += length;
+        return value;
+    }
+};
+
+//tuples are written element by element
+template <class Tuple, std::size_t Index = std::tuple_size<Tuple>::value>
+struct TupleSerializer
+{
+    typedef typename std::tuple_element<Index-1, Tuple>::type Element;
+    static constexpr std::size_t fixed_size()
+    {
+        return TupleSerializer<Tuple, Index-1>::fixed_size() +
+            Serializer<Element>::fixed_size();
+    }
+
+    static std::string signature()
+    {
+        std::string head = TupleSerializer<Tuple, Index-1>::signature();
+        return head + (Index > 1 ? "," : "") + Serializer<Element>::signature();
+    }
+
+    static void write(const Tuple& value, std::string& buffer)
+    {
+        TupleSerializer<Tuple, Index-1>::write(value, buffer);
+        Serializer<Element>::write(std::get<Index-1>(value), buffer);
+    }
+
+    static void read(Tuple& value, const char*& cursor, const char* end)
+    {
+        TupleSerializer<Tuple, Index-1>::read(value, cursor, end);
+        std::get<Index-1>(value) = Serializer<Element>::read(cursor, end);
+    }
+};
+
+template <class Tuple>
+struct TupleSerializer<Tuple, 0>
+{
+    static constexpr std::size_t fixed_size() {return 0;}
+    static std::string signature() {return "";}
+    static void write(const Tuple&, std::string&) {}
+    static void read(Tuple&, const char*&, const char*) {}
+};
+
+template <typename... TT>
+struct Serializer<std::tuple<TT...> >
+{
+    static constexpr std::size_t fixed_size()
+    {
+        return TupleSerializer<std::tuple<TT...> >::fixed_size();
+    }
+
+    static std::string signature()
+    {
+        return "(" + TupleSerializer<std::tuple<TT...> >::signature() + ")";
+    }
+
+    static void write(const std::tuple<TT...>& value, std::string& buffer)
+    {
+        TupleSerializer<std::tuple<TT...> >::write(value, buffer);
+    }
+
+    static std::tuple<TT...> read(const char*& cursor, const char* end)
+    {
+        std::tuple<TT...> value;
+        TupleSerializer<std::tuple<TT...> >::read(value, cursor, end);
+        return value;
+    }
+};
+
+//true for the types that have a serializer
+template <typename T, typename Enable = void>
+struct is_serializable : std::false_type {};
+
+template <typename T>
+struct is_serializable<T,
+    typename std::enable_if<std::is_arithmetic<T>::value>::type> :
+    std::true_type {};
+
+template <>
+struct is_serializable<std::string> : std::true_type {};
+
+template <>
+struct is_serializable<std::tuple<> > : std::true_type {};
+
+template <typename T, typename... TT>
+struct is_serializable<std::tuple<T, TT...> > :
+    std::integral_constant<bool, is_serializable<T>::value and
+        is_serializable<std::tuple<TT...> >::value> {};
+
+}//end of namespace sset
+
+#endif /* SERIALIZER_HPP_ */
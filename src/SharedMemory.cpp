@@ -0,0 +1,204 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SharedMemory.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace sset
+{//start of namespace sset
+
+#ifdef _WIN32
+
+//shared-memory sets rely on POSIX shared memory and process-shared locks
+SharedMemory::SharedMemory(const string&, size_t) : data_(nullptr), size_(0)
+{
+    throw runtime_error("Shared memory is not supported on this platform");
+}
+
+SharedMemory::SharedMemory(const string&) : data_(nullptr), size_(0)
+{
+    throw runtime_error("Shared memory is not supported on this platform");
+}
+
+SharedMemory::~SharedMemory() {}
+
+void SharedMemory::unlink(const string&)
+{
+    throw runtime_error("Shared memory is not supported on this platform");
+}
+
+void store_shared_word(char* word, uint64_t value)
+{
+    memcpy(word, &value, sizeof(uint64_t));
+}
+
+uint64_t load_shared_word(const char* word)
+{
+    uint64_t value;
+    memcpy(&value, word, sizeof(uint64_t));
+    return value;
+}
+
+void init_shared_lock(char*)
+{
+    throw runtime_error("Shared memory is not supported on this platform");
+}
+
+SharedLockGuard::SharedLockGuard(char* lock, bool) : lock_(lock) {}
+
+SharedLockGuard::~SharedLockGuard() {}
+
+#else
+
+static_assert(sizeof(pthread_rwlock_t) <= SHARED_LOCK_SIZE,
+        "SHARED_LOCK_SIZE is too small for a pthread_rwlock_t");
+
+//map a segment opened with the given flags, the segment is resized if a
+//size is given
+char* map_segment(const string& name, int flags, size_t& size)
+{
+    int segment = shm_open(name.c_str(), flags, 0600);
+    if (segment == -1)
+    {
+        throw runtime_error("Cannot open the shared memory segment "
+                + name + ": " + strerror(errno));
+    }
+    struct stat segment_status;
+    if ((size > 0 and ftruncate(segment, size) == -1) or
+            (size == 0 and fstat(segment, &segment_status) == -1))
+    {
+        close(segment);
+        if (flags & O_CREAT)
+        {
+            shm_unlink(name.c_str());
+        }
+        throw runtime_error("Cannot size the shared memory segment " + name);
+    }
+    if (size == 0)
+    {
+        size = static_cast<size_t>(segment_status.st_size);
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            segment, 0);
+    close(segment);
+    if (data == MAP_FAILED)
+    {
+        if (flags & O_CREAT)
+        {
+            shm_unlink(name.c_str());
+        }
+        throw runtime_error("Cannot map the shared memory segment " + name);
+    }
+    return static_cast<char*>(data);
+}
+
+SharedMemory::SharedMemory(const string& name, size_t size) :
+    data_(nullptr),
+    size_(size)
+{
+    if (size == 0)
+    {
+        throw invalid_argument("Empty shared memory segment");
+    }
+    data_ = map_segment(name, O_CREAT | O_EXCL | O_RDWR, size_);
+}
+
+SharedMemory::SharedMemory(const string& name) :
+    data_(nullptr),
+    size_(0)
+{
+    data_ = map_segment(name, O_RDWR, size_);
+}
+
+SharedMemory::~SharedMemory()
+{
+    munmap(data_, size_);
+}
+
+void SharedMemory::unlink(const string& name)
+{
+    if (shm_unlink(name.c_str()) == -1)
+    {
+        throw runtime_error("Cannot unlink the shared memory segment "
+                + name + ": " + strerror(errno));
+    }
+}
+
+void store_shared_word(char* word, uint64_t value)
+{
+    __atomic_store_n(reinterpret_cast<uint64_t*>(word), value,
+            __ATOMIC_RELEASE);
+}
+
+uint64_t load_shared_word(const char* word)
+{
+    return __atomic_load_n(reinterpret_cast<const uint64_t*>(word),
+            __ATOMIC_ACQUIRE);
+}
+
+void init_shared_lock(char* lock)
+{
+    pthread_rwlockattr_t attributes;
+    pthread_rwlockattr_init(&attributes);
+    pthread_rwlockattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    int error = pthread_rwlock_init(
+            reinterpret_cast<pthread_rwlock_t*>(lock), &attributes);
+    pthread_rwlockattr_destroy(&attributes);
+    if (error != 0)
+    {
+        throw runtime_error("Cannot initialize the shared lock");
+    }
+}
+
+SharedLockGuard::SharedLockGuard(char* lock, bool exclusive) : lock_(lock)
+{
+    pthread_rwlock_t* rwlock = reinterpret_cast<pthread_rwlock_t*>(lock_);
+    int error = exclusive ? pthread_rwlock_wrlock(rwlock) :
+        pthread_rwlock_rdlock(rwlock);
+    if (error != 0)
+    {
+        throw runtime_error("Cannot acquire the shared lock");
+    }
+}
+
+SharedLockGuard::~SharedLockGuard()
+{
+    pthread_rwlock_unlock(reinterpret_cast<pthread_rwlock_t*>(lock_));
+}
+
+#endif
+
+}//end of namespace sset
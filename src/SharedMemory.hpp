@@ -0,0 +1,85 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SHAREDMEMORY_HPP_
+#define SHAREDMEMORY_HPP_
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace sset
+{//start of namespace sset
+
+const std::size_t SHARED_LOCK_SIZE = 128; //bytes reserved for a lock
+
+//Named POSIX shared-memory segment mapped in the address space of the
+//process. The segment exists until it is unlinked, even if no process
+//maps it.
+class SharedMemory
+{
+public:
+    //create a new segment of the given size
+    SharedMemory(const std::string& name, std::size_t size);
+    //open an existing segment
+    explicit SharedMemory(const std::string& name);
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+    ~SharedMemory();
+
+    char* data() const {return data_;}
+    std::size_t size() const {return size_;}
+    static void unlink(const std::string& name);
+
+private:
+    char* data_;
+    std::size_t size_;
+};
+
+//8-byte aligned word of a shared segment written with release ordering and
+//read with acquire ordering: the writes preceding the store are visible to a
+//process that reads the stored value
+void store_shared_word(char* word, uint64_t value);
+uint64_t load_shared_word(const char* word);
+
+//Reader-writer lock shared between processes, stored in SHARED_LOCK_SIZE
+//bytes of a shared segment. The lock is not robust: if a process dies while
+//holding it, the other processes wait for it forever.
+void init_shared_lock(char* lock);
+
+class SharedLockGuard
+{
+public:
+    SharedLockGuard(char* lock, bool exclusive);
+    SharedLockGuard(const SharedLockGuard&) = delete;
+    SharedLockGuard& operator=(const SharedLockGuard&) = delete;
+    ~SharedLockGuard();
+
+private:
+    char* lock_;
+};
+
+}//end of namespace sset
+
+#endif /* SHAREDMEMORY_HPP_ */
@@ -0,0 +1,653 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SHAREDSAMPLABLESET_HPP_
+#define SHAREDSAMPLABLESET_HPP_
+
+#include "SamplableSet.hpp"
+#include "SharedMemory.hpp"
+#include <string>
+#include <vector>
+#include <utility>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+namespace sset
+{//start of namespace sset
+
+const char SHARED_SET_MAGIC[] = "SSETSHM";
+const uint32_t SHARED_SET_VERSION = 1;
+const uint64_t EMPTY_ENTRY = UINT64_MAX;
+
+//Header of the segment of a shared set, after the lock. The magic is
+//written last, once the rest of the segment is initialized.
+struct SharedSetHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t key_size;
+    char signature[32];
+    double min_weight;
+    double max_weight;
+    uint64_t capacity;
+    uint64_t number_of_groups;
+    uint64_t tree_leaves;
+    uint64_t table_size;
+};
+
+//Offsets of the sections of the segment of a shared set
+struct SharedSetLayout
+{
+    std::size_t group_start;
+    std::size_t tree;
+    std::size_t weights;
+    std::size_t table;
+    std::size_t keys;
+    std::size_t size;
+
+    SharedSetLayout(const SharedSetHeader& header)
+    {
+        group_start = SHARED_LOCK_SIZE + sizeof(SharedSetHeader);
+        tree = group_start + (header.number_of_groups+1)*sizeof(uint64_t);
+        weights = tree + 2*header.tree_leaves*sizeof(double);
+        table = weights + header.capacity*sizeof(double);
+        keys = table + header.table_size*sizeof(uint64_t);
+        size = keys + header.capacity*header.key_size;
+    }
+};
+
+//hash of the bytes of a key, mixed by 64-bit words
+inline uint64_t hash_key_bytes(const char* bytes, std::size_t key_size)
+{
+    uint64_t hash = 0x9e3779b97f4a7c15ULL;
+    for (std::size_t i = 0; i < key_size; i += 8)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes + i, std::min<std::size_t>(8, key_size - i));
+        hash ^= word;
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+    }
+    return hash;
+}
+
+/*
+ * Samplable set stored in a POSIX shared-memory segment, so that processes
+ * opening the segment by its name share a single set. The elements must
+ * have a fixed size. The segment holds a process-shared reader-writer lock,
+ * the groups of elements stored contiguously one after the other, an
+ * implicit binary tree of the group weights and an open addressing hash
+ * table of the positions of the elements. Nothing refers to addresses, so
+ * that processes can map the segment anywhere.
+ *
+ * Unlike SamplableSet, the methods lock the set themselves: modifications
+ * hold the lock exclusively and the other methods hold it shared. Moving an
+ * element between groups shifts one element per group in between. The lock
+ * is not robust, a process killed during a method blocks the others.
+ */
+template <class T>
+class SharedSamplableSet : public BaseSamplableSet
+{
+public:
+    //create a new segment holding up to capacity elements
+    SharedSamplableSet(const std::string& name, double min_weight,
+            double max_weight, std::size_t capacity);
+    //open an existing segment
+    explicit SharedSamplableSet(const std::string& name);
+    static void unlink(const std::string& name) {SharedMemory::unlink(name);}
+
+    //Accessors
+    std::size_t size() const;
+    bool empty() const {return size() == 0;}
+    std::size_t capacity() const {return header_->capacity;}
+    double min_weight() const {return header_->min_weight;}
+    double max_weight() const {return header_->max_weight;}
+    std::size_t number_of_groups() const {return header_->number_of_groups;}
+    double total_weight() const;
+    std::size_t count(const T& element) const;
+    double get_weight(const T& element) const;
+    std::pair<T,double> sample() const;
+    template <typename ExtRNG>
+    std::pair<T,double> sample_ext_RNG(ExtRNG& gen) const;
+
+    //Mutators
+    void insert(const T& element, double weight = 0);
+    void set_weight(const T& element, double weight);
+    void erase(const T& element);
+    void clear();
+
+private:
+    SharedMemory memory_;
+    SharedSetHeader* header_;
+    uint64_t* group_start_;
+    double* tree_;
+    double* weights_;
+    uint64_t* table_;
+    char* keys_;
+    HashPropensity hash_;
+    std::vector<double> max_propensity_vector_;
+    mutable std::uniform_real_distribution<double> random_01_;
+    //private methods
+    static std::size_t segment_size(double min_weight, double max_weight,
+            std::size_t capacity);
+    static SharedSetHeader* init_segment(SharedMemory& memory,
+            const std::string& name, double min_weight, double max_weight,
+            std::size_t capacity);
+    static SharedSetHeader* checked_segment(const SharedMemory& memory,
+            const std::string& name);
+    void attach();
+    void publish();
+    void weight_checkup(double weight) const;
+    char* lock() const {return memory_.data();}
+    std::string key_bytes(const T& element) const;
+    const char* slot_key(uint64_t slot) const
+        {return keys_ + slot*header_->key_size;}
+    uint64_t find_entry(const char* bytes) const;
+    GroupIndex slot_group(uint64_t slot) const;
+    void move_slot(uint64_t from, uint64_t to);
+    void update_tree(GroupIndex group_index, double variation);
+    void insert_unlocked(const std::string& bytes, uint64_t entry,
+            double weight);
+    void erase_unlocked(uint64_t entry);
+};
+
+//header of a new segment, the sections are sized for the capacity
+inline SharedSetHeader new_shared_set_header(const std::string& signature,
+        std::size_t key_size, double min_weight, double max_weight,
+        std::size_t capacity)
+{
+    if (signature.size() >= sizeof(SharedSetHeader::signature))
+    {
+        throw std::invalid_argument("Key type too long for a shared set");
+    }
+    SharedSetHeader header;
+    std::memset(&header, 0, sizeof(SharedSetHeader));
+    std::memcpy(header.magic, SHARED_SET_MAGIC, sizeof(SHARED_SET_MAGIC));
+    header.version = SHARED_SET_VERSION;
+    header.key_size = key_size;
+    std::memcpy(header.signature, signature.data(), signature.size());
+    header.min_weight = min_weight;
+    header.max_weight = max_weight;
+    header.capacity = capacity;
+    header.number_of_groups = HashPropensity(min_weight,
+            max_weight)(max_weight) + 1;
+    header.tree_leaves = 1;
+    while (header.tree_leaves < header.number_of_groups)
+    {
+        header.tree_leaves *= 2;
+    }
+    header.table_size = 2;
+    while (header.table_size < 2*capacity)
+    {
+        header.table_size *= 2;
+    }
+    return header;
+}
+
+template <typename T>
+std::size_t SharedSamplableSet<T>::segment_size(double min_weight,
+        double max_weight, std::size_t capacity)
+{
+    if (min_weight <= 0 or max_weight < min_weight or capacity == 0)
+    {
+        throw std::invalid_argument("Invalid weight bounds or capacity");
+    }
+    return SharedSetLayout(new_shared_set_header(Serializer<T>::signature(),
+                Serializer<T>::fixed_size(), min_weight, max_weight,
+                capacity)).size;
+}
+
+//value of the first word of the header of a complete segment
+inline uint64_t shared_set_magic_word()
+{
+    uint64_t word;
+    std::memcpy(&word, SHARED_SET_MAGIC, sizeof(uint64_t));
+    return word;
+}
+
+//initialize the lock and the header of a new segment, except the magic
+template <typename T>
+SharedSetHeader* SharedSamplableSet<T>::init_segment(SharedMemory& memory,
+        const std::string& name, double min_weight, double max_weight,
+        std::size_t capacity)
+{
+    try
+    {
+        init_shared_lock(memory.data());
+    }
+    catch (...)
+    {
+        SharedMemory::unlink(name);
+        throw;
+    }
+    SharedSetHeader* header = reinterpret_cast<SharedSetHeader*>(
+            memory.data() + SHARED_LOCK_SIZE);
+    SharedSetHeader new_header = new_shared_set_header(
+            Serializer<T>::signature(), Serializer<T>::fixed_size(),
+            min_weight, max_weight, capacity);
+    std::memset(new_header.magic, 0, sizeof(new_header.magic));
+    *header = new_header;
+    return header;
+}
+
+//check that an existing segment holds a set of the right type
+template <typename T>
+SharedSetHeader* SharedSamplableSet<T>::checked_segment(
+        const SharedMemory& memory, const std::string& name)
+{
+    SharedSetHeader* header = reinterpret_cast<SharedSetHeader*>(
+            memory.data() + SHARED_LOCK_SIZE);
+    if (memory.size() < SHARED_LOCK_SIZE + sizeof(SharedSetHeader) or
+            load_shared_word(header->magic) != shared_set_magic_word() or
+            header->version != SHARED_SET_VERSION or
+            memory.size() < SharedSetLayout(*header).size)
+    {
+        throw std::invalid_argument("The segment " + name
+                + " does not hold a shared samplable set");
+    }
+    const char* signature_begin = header->signature;
+    std::string signature(signature_begin, std::find(signature_begin,
+                signature_begin + sizeof(header->signature), '\0'));
+    if (signature != Serializer<T>::signature())
+    {
+        throw std::invalid_argument("Shared set of elements of type "
+                + signature + " instead of " + Serializer<T>::signature());
+    }
+    if (header->number_of_groups != HashPropensity(header->min_weight,
+                header->max_weight)(header->max_weight) + 1)
+    {
+        throw std::invalid_argument("Inconsistent number of groups in the "
+                "segment " + name);
+    }
+    return header;
+}
+
+//create the segment, the sections start empty
+//other processes can open it once it is published
+template <typename T>
+SharedSamplableSet<T>::SharedSamplableSet(const std::string& name,
+        double min_weight, double max_weight, std::size_t capacity) :
+    memory_(name, segment_size(min_weight, max_weight, capacity)),
+    header_(init_segment(memory_, name, min_weight, max_weight, capacity)),
+    group_start_(nullptr),
+    tree_(nullptr),
+    weights_(nullptr),
+    table_(nullptr),
+    keys_(nullptr),
+    hash_(min_weight, max_weight),
+    max_propensity_vector_(),
+    random_01_(0.,1.)
+{
+    attach();
+    std::fill(table_, table_ + header_->table_size, EMPTY_ENTRY);
+    publish();
+}
+
+//open an existing segment
+template <typename T>
+SharedSamplableSet<T>::SharedSamplableSet(const std::string& name) :
+    memory_(name),
+    header_(checked_segment(memory_, name)),
+    group_start_(nullptr),
+    tree_(nullptr),
+    weights_(nullptr),
+    table_(nullptr),
+    keys_(nullptr),
+    hash_(header_->min_weight, header_->max_weight),
+    max_propensity_vector_(),
+    random_01_(0.,1.)
+{
+    attach();
+}
+
+//locate the sections and compute the bounds of the groups
+template <typename T>
+void SharedSamplableSet<T>::attach()
+{
+    SharedSetLayout layout(*header_);
+    group_start_ = reinterpret_cast<uint64_t*>(memory_.data() +
+            layout.group_start);
+    tree_ = reinterpret_cast<double*>(memory_.data() + layout.tree);
+    weights_ = reinterpret_cast<double*>(memory_.data() + layout.weights);
+    table_ = reinterpret_cast<uint64_t*>(memory_.data() + layout.table);
+    keys_ = memory_.data() + layout.keys;
+    max_propensity_vector_ = hash_.max_propensities();
+}
+
+//write the magic, after the lock and the sections are initialized
+template <typename T>
+void SharedSamplableSet<T>::publish()
+{
+    store_shared_word(header_->magic, shared_set_magic_word());
+}
+
+template <typename T>
+void SharedSamplableSet<T>::weight_checkup(double weight) const
+{
+    if (not (weight >= min_weight() and weight <= max_weight()))
+    {
+        throw std::invalid_argument("Weight " + std::to_string(weight)
+                + " out of bounds [" + std::to_string(min_weight()) + ","
+                + std::to_string(max_weight()) + "]");
+    }
+}
+
+template <typename T>
+std::string SharedSamplableSet<T>::key_bytes(const T& element) const
+{
+    std::string bytes;
+    Serializer<T>::write(element, bytes);
+    return bytes;
+}
+
+//index of the entry of the table holding a key, or of the empty entry
+//where it would be inserted
+template <typename T>
+uint64_t SharedSamplableSet<T>::find_entry(const char* bytes) const
+{
+    const uint64_t mask = header_->table_size - 1;
+    const std::size_t key_size = header_->key_size;
+    uint64_t entry = hash_key_bytes(bytes, key_size) & mask;
+    while (table_[entry] != EMPTY_ENTRY and
+            std::memcmp(slot_key(table_[entry]), bytes, key_size) != 0)
+    {
+        entry = (entry + 1) & mask;
+    }
+    return entry;
+}
+
+template <typename T>
+GroupIndex SharedSamplableSet<T>::slot_group(uint64_t slot) const
+{
+    const uint64_t* group_end = group_start_ + header_->number_of_groups + 1;
+    return std::upper_bound<const uint64_t*>(group_start_, group_end, slot) -
+        group_start_ - 1;
+}
+
+//move the element of a slot to another one, its entry follows it
+template <typename T>
+void SharedSamplableSet<T>::move_slot(uint64_t from, uint64_t to)
+{
+    const std::size_t key_size = header_->key_size;
+    table_[find_entry(slot_key(from))] = to;
+    weights_[to] = weights_[from];
+    std::memcpy(keys_ + to*key_size, slot_key(from), key_size);
+}
+
+template <typename T>
+void SharedSamplableSet<T>::update_tree(GroupIndex group_index,
+        double variation)
+{
+    for (uint64_t node = header_->tree_leaves + group_index; node >= 1;
+            node /= 2)
+    {
+        tree_[node] += variation;
+    }
+}
+
+//insert an element at the end of its group, the first element of each
+//following group is moved to the end of its group to make room
+template <typename T>
+void SharedSamplableSet<T>::insert_unlocked(const std::string& bytes,
+        uint64_t entry, double weight)
+{
+    const GroupIndex number_of_group = header_->number_of_groups;
+    if (group_start_[number_of_group] == header_->capacity)
+    {
+        throw std::length_error("The shared set is full");
+    }
+    GroupIndex group_index = hash_(weight);
+    uint64_t free_slot = group_start_[number_of_group];
+    for (GroupIndex k = number_of_group - 1; k > group_index; k--)
+    {
+        if (group_start_[k] < group_start_[k+1])
+        {
+            move_slot(group_start_[k], free_slot);
+        }
+        free_slot = group_start_[k];
+    }
+    weights_[free_slot] = weight;
+    std::memcpy(keys_ + free_slot*header_->key_size, bytes.data(),
+            header_->key_size);
+    table_[entry] = free_slot;
+    for (GroupIndex k = group_index + 1; k <= number_of_group; k++)
+    {
+        group_start_[k]++;
+    }
+    update_tree(group_index, weight);
+}
+
+//remove the element of an entry, the hole is filled by the last element of
+//its group and the last element of each following group fills the hole
+//left before it
+template <typename T>
+void SharedSamplableSet<T>::erase_unlocked(uint64_t entry)
+{
+    const GroupIndex number_of_group = header_->number_of_groups;
+    const uint64_t mask = header_->table_size - 1;
+    uint64_t slot = table_[entry];
+    GroupIndex group_index = slot_group(slot);
+    double weight = weights_[slot];
+
+    //backward shift deletion of the entry
+    uint64_t hole = entry;
+    uint64_t next = entry;
+    while (true)
+    {
+        next = (next + 1) & mask;
+        if (table_[next] == EMPTY_ENTRY)
+        {
+            break;
+        }
+        uint64_t home = hash_key_bytes(slot_key(table_[next]),
+                header_->key_size) & mask;
+        bool stays = hole <= next ? (hole < home and home <= next) :
+            (hole < home or home <= next);
+        if (not stays)
+        {
+            table_[hole] = table_[next];
+            hole = next;
+        }
+    }
+    table_[hole] = EMPTY_ENTRY;
+
+    uint64_t free_slot = group_start_[group_index+1] - 1;
+    if (slot != free_slot)
+    {
+        move_slot(free_slot, slot);
+    }
+    for (GroupIndex k = group_index + 1; k < number_of_group; k++)
+    {
+        if (group_start_[k] < group_start_[k+1])
+        {
+            move_slot(group_start_[k+1] - 1, free_slot);
+        }
+        free_slot = group_start_[k+1] - 1;
+    }
+    for (GroupIndex k = group_index + 1; k <= number_of_group; k++)
+    {
+        group_start_[k]--;
+    }
+    update_tree(group_index, -weight);
+}
+
+template <typename T>
+std::size_t SharedSamplableSet<T>::size() const
+{
+    SharedLockGuard guard(lock(), false);
+    return group_start_[header_->number_of_groups];
+}
+
+template <typename T>
+double SharedSamplableSet<T>::total_weight() const
+{
+    SharedLockGuard guard(lock(), false);
+    return tree_[1];
+}
+
+template <typename T>
+std::size_t SharedSamplableSet<T>::count(const T& element) const
+{
+    std::string bytes = key_bytes(element);
+    SharedLockGuard guard(lock(), false);
+    return table_[find_entry(bytes.data())] != EMPTY_ENTRY;
+}
+
+template <typename T>
+double SharedSamplableSet<T>::get_weight(const T& element) const
+{
+    std::string bytes = key_bytes(element);
+    SharedLockGuard guard(lock(), false);
+    uint64_t slot = table_[find_entry(bytes.data())];
+    if (slot == EMPTY_ENTRY)
+    {
+        throw std::out_of_range("Key error, the element is not in the set");
+    }
+    return weights_[slot];
+}
+
+//sample an element according to its weight
+template <typename T>
+std::pair<T,double> SharedSamplableSet<T>::sample() const
+{
+    return sample_ext_RNG(gen_);
+}
+
+//sample an element according to its weight using an external RNG
+//the group is found by walking down the tree, then the element by rejection
+template <typename T>
+template <typename ExtRNG>
+std::pair<T,double> SharedSamplableSet<T>::sample_ext_RNG(ExtRNG& gen) const
+{
+    SharedLockGuard guard(lock(), false);
+    const GroupIndex number_of_group = header_->number_of_groups;
+    if (group_start_[number_of_group] == 0)
+    {
+        throw std::out_of_range("The samplable set is empty");
+    }
+    double value = random_01_(gen)*tree_[1];
+    uint64_t node = 1;
+    while (node < header_->tree_leaves)
+    {
+        node *= 2;
+        if (value >= tree_[node])
+        {
+            value -= tree_[node];
+            node++;
+        }
+    }
+    GroupIndex group_index = node - header_->tree_leaves;
+    //rounding errors could lead to an empty group
+    while (group_index >= number_of_group or
+            group_start_[group_index] == group_start_[group_index+1])
+    {
+        group_index = (group_index + 1) % number_of_group;
+    }
+    uint64_t group_size = group_start_[group_index+1] -
+        group_start_[group_index];
+    uint64_t slot;
+    do
+    {
+        slot = group_start_[group_index] +
+            std::min<uint64_t>(floor(random_01_(gen)*group_size),
+                    group_size - 1);
+    }
+    while (random_01_(gen) >=
+            weights_[slot]/max_propensity_vector_[group_index]);
+    const char* cursor = slot_key(slot);
+    T element = Serializer<T>::read(cursor, cursor + header_->key_size);
+    return std::make_pair(element, weights_[slot]);
+}
+
+//insert an element in the set with its associated weight
+//if the element is already there, do nothing
+template <typename T>
+void SharedSamplableSet<T>::insert(const T& element, double weight)
+{
+    weight_checkup(weight);
+    std::string bytes = key_bytes(element);
+    SharedLockGuard guard(lock(), true);
+    uint64_t entry = find_entry(bytes.data());
+    if (table_[entry] == EMPTY_ENTRY)
+    {
+        insert_unlocked(bytes, entry, weight);
+    }
+}
+
+//set a new weight for the element in the set
+//if the element does not exists, same as insert
+template <typename T>
+void SharedSamplableSet<T>::set_weight(const T& element, double weight)
+{
+    weight_checkup(weight);
+    std::string bytes = key_bytes(element);
+    SharedLockGuard guard(lock(), true);
+    uint64_t entry = find_entry(bytes.data());
+    uint64_t slot = table_[entry];
+    if (slot != EMPTY_ENTRY and slot_group(slot) == hash_(weight))
+    {
+        update_tree(hash_(weight), weight - weights_[slot]);
+        weights_[slot] = weight;
+        return;
+    }
+    if (slot != EMPTY_ENTRY)
+    {
+        erase_unlocked(entry);
+        entry = find_entry(bytes.data());
+    }
+    insert_unlocked(bytes, entry, weight);
+}
+
+//remove an element from the set
+template <typename T>
+void SharedSamplableSet<T>::erase(const T& element)
+{
+    std::string bytes = key_bytes(element);
+    SharedLockGuard guard(lock(), true);
+    uint64_t entry = find_entry(bytes.data());
+    if (table_[entry] != EMPTY_ENTRY)
+    {
+        erase_unlocked(entry);
+    }
+}
+
+//remove all elements from the set
+template <typename T>
+void SharedSamplableSet<T>::clear()
+{
+    SharedLockGuard guard(lock(), true);
+    std::fill(group_start_, group_start_ + header_->number_of_groups + 1, 0);
+    std::fill(tree_, tree_ + 2*header_->tree_leaves, 0.);
+    std::fill(table_, table_ + header_->table_size, EMPTY_ENTRY);
+}
+
+}//end of namespace sset
+
+#endif /* SHAREDSAMPLABLESET_HPP_ */
@@ -0,0 +1,219 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Snapshot.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+using namespace std;
+
+namespace sset
+{//start of namespace sset
+
+const char SNAPSHOT_MAGIC[] = "SSETSNAP";
+const size_t SNAPSHOT_MAGIC_SIZE = 8;
+
+//write the header of a snapshot
+void SnapshotHeader::write(string& buffer) const
+{
+    buffer.append(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+    Serializer<uint32_t>::write(version, buffer);
+    Serializer<uint32_t>::write(flags, buffer);
+    Serializer<string>::write(signature, buffer);
+    pad_snapshot(buffer);
+    Serializer<double>::write(min_weight, buffer);
+    Serializer<double>::write(max_weight, buffer);
+    Serializer<uint64_t>::write(number_of_groups, buffer);
+    Serializer<uint64_t>::write(size, buffer);
+    for (double group_weight : group_weight_vector)
+    {
+        Serializer<double>::write(group_weight, buffer);
+    }
+    if (flags & SNAPSHOT_RNG_STATE)
+    {
+        Serializer<uint64_t>::write(rng_state, buffer);
+        Serializer<uint64_t>::write(rng_increment, buffer);
+    }
+}
+
+//read the header of a snapshot, the cursor is moved after it
+SnapshotHeader SnapshotHeader::read(const char*& cursor, const char* begin,
+        const char* end)
+{
+    if (end - cursor < static_cast<ptrdiff_t>(SNAPSHOT_MAGIC_SIZE) or
+            string(cursor, SNAPSHOT_MAGIC_SIZE) != SNAPSHOT_MAGIC)
+    {
+        throw invalid_argument("Not a samplable set snapshot");
+    }
+    cursor += SNAPSHOT_MAGIC_SIZE;
+    SnapshotHeader header;
+    header.version = Serializer<uint32_t>::read(cursor, end);
+    if (header.version != SNAPSHOT_VERSION)
+    {
+        throw invalid_argument("Unsupported snapshot version "
+                + to_string(header.version));
+    }
+    header.flags = Serializer<uint32_t>::read(cursor, end);
+    if (header.flags & ~SNAPSHOT_KNOWN_FLAGS)
+    {
+        throw invalid_argument("Unsupported snapshot flags");
+    }
+    header.signature = Serializer<string>::read(cursor, end);
+    skip_snapshot_padding(cursor, begin, end);
+    header.min_weight = Serializer<double>::read(cursor, end);
+    header.max_weight = Serializer<double>::read(cursor, end);
+    if (not (header.min_weight > 0) or not (header.max_weight >=
+                header.min_weight) or std::isinf(header.max_weight))
+    {
+        throw invalid_argument("Invalid bounds of the weights in the "
+                "snapshot");
+    }
+    header.number_of_groups = Serializer<uint64_t>::read(cursor, end);
+    header.size = Serializer<uint64_t>::read(cursor, end);
+    if (static_cast<uint64_t>(end - cursor)/sizeof(double) <
+            header.number_of_groups)
+    {
+        throw invalid_argument("Truncated serialized data");
+    }
+    header.group_weight_vector.reserve(header.number_of_groups);
+    for (uint64_t i = 0; i < header.number_of_groups; i++)
+    {
+        double group_weight = Serializer<double>::read(cursor, end);
+        if (not std::isfinite(group_weight))
+        {
+            throw invalid_argument("Invalid weight of a group in the "
+                    "snapshot");
+        }
+        header.group_weight_vector.push_back(group_weight);
+    }
+    header.rng_state = 0;
+    header.rng_increment = 0;
+    if (header.flags & SNAPSHOT_RNG_STATE)
+    {
+        header.rng_state = Serializer<uint64_t>::read(cursor, end);
+        header.rng_increment = Serializer<uint64_t>::read(cursor, end);
+    }
+    return header;
+}
+
+void check_snapshot_group_weight(double group_weight, double weight_sum)
+{
+    if (not (fabs(group_weight - weight_sum) <=
+                SNAPSHOT_WEIGHT_TOLERANCE*weight_sum))
+    {
+        throw invalid_argument("Weight of a group inconsistent with the "
+                "weights of its elements");
+    }
+}
+
+void check_snapshot_group_bounds(double group_weight, uint64_t group_size,
+        double min_weight, double max_weight)
+{
+    if (not (group_weight >= group_size*min_weight*
+                (1 - SNAPSHOT_WEIGHT_TOLERANCE) and
+            group_weight <= group_size*max_weight*
+                (1 + SNAPSHOT_WEIGHT_TOLERANCE)))
+    {
+        throw invalid_argument("Weight of a group inconsistent with its "
+                "number of elements");
+    }
+}
+
+void pad_snapshot(string& buffer)
+{
+    size_t remainder = buffer.size() % SNAPSHOT_ALIGNMENT;
+    if (remainder != 0)
+    {
+        buffer.append(SNAPSHOT_ALIGNMENT - remainder, '\0');
+    }
+}
+
+void skip_snapshot_padding(const char*& cursor, const char* begin,
+        const char* end)
+{
+    size_t remainder = (cursor - begin) % SNAPSHOT_ALIGNMENT;
+    if (remainder != 0)
+    {
+        if (static_cast<size_t>(end - cursor) < SNAPSHOT_ALIGNMENT - remainder)
+        {
+            throw invalid_argument("Truncated serialized data");
+        }
+        cursor += SNAPSHOT_ALIGNMENT - remainder;
+    }
+}
+
+//the header is read by sections, whose sizes are given by the previous ones
+//sections are read by chunks, so that a corrupted size fails at the end of
+//the stream instead of allocating the whole section
+SnapshotHeader read_snapshot_header(istream& stream)
+{
+    string buffer;
+    auto read_section = [&stream, &buffer](uint64_t n_bytes)
+    {
+        while (n_bytes > 0)
+        {
+            size_t chunk_size = static_cast<size_t>(
+                    min<uint64_t>(n_bytes, SNAPSHOT_CHUNK_SIZE));
+            size_t offset = buffer.size();
+            buffer.resize(offset + chunk_size);
+            if (not stream.read(&buffer[offset], chunk_size))
+            {
+                throw invalid_argument("Truncated serialized data");
+            }
+            n_bytes -= chunk_size;
+        }
+    };
+    //magic, version, flags and length of the signature
+    read_section(SNAPSHOT_MAGIC_SIZE + 16);
+    const char* cursor = buffer.data() + SNAPSHOT_MAGIC_SIZE + 4;
+    uint32_t flags = Serializer<uint32_t>::read(cursor,
+            buffer.data() + buffer.size());
+    uint64_t length = Serializer<uint64_t>::read(cursor,
+            buffer.data() + buffer.size());
+    //signature, padding, bounds and sizes
+    if (length > numeric_limits<uint64_t>::max() - 64)
+    {
+        throw invalid_argument("Truncated serialized data");
+    }
+    uint64_t signature_size = length + (SNAPSHOT_ALIGNMENT -
+            length % SNAPSHOT_ALIGNMENT) % SNAPSHOT_ALIGNMENT;
+    read_section(signature_size + 32);
+    cursor = buffer.data() + buffer.size() - 16;
+    uint64_t number_of_groups = Serializer<uint64_t>::read(cursor,
+            buffer.data() + buffer.size());
+    //weights of the groups and state of the RNG
+    if (number_of_groups > numeric_limits<uint64_t>::max()/sizeof(double) - 2)
+    {
+        throw invalid_argument("Truncated serialized data");
+    }
+    read_section(number_of_groups*sizeof(double) +
+            (flags & SNAPSHOT_RNG_STATE ? 16 : 0));
+    cursor = buffer.data();
+    return SnapshotHeader::read(cursor, buffer.data(),
+            buffer.data() + buffer.size());
+}
+
+}//end of namespace sset
@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SNAPSHOT_HPP_
+#define SNAPSHOT_HPP_
+
+#include "Serializer.hpp"
+#include <string>
+#include <vector>
+#include <istream>
+#include <cstdint>
+
+namespace sset
+{//start of namespace sset
+
+/*
+ * Snapshot files of samplable sets. All numbers are little-endian and the
+ * sections start at multiples of 8 bytes:
+ *   magic "SSETSNAP", uint32 version, uint32 flags
+ *   key signature (uint64 length and characters)
+ *   double min_weight, double max_weight, uint64 number of groups,
+ *   uint64 number of elements, double total weight of each group
+ *   if the flag SNAPSHOT_RNG_STATE is set: uint64 state and increment of
+ *   the RNG shared by the sets
+ *   for each group: uint64 size, double weights[size], keys[size]
+ */
+const uint32_t SNAPSHOT_VERSION = 1;
+const std::size_t SNAPSHOT_ALIGNMENT = 8;
+const std::size_t SNAPSHOT_CHUNK_SIZE = 1 << 20; //bytes written at once
+const uint32_t SNAPSHOT_RNG_STATE = 1; //flag of snapshots with the RNG state
+const uint32_t SNAPSHOT_KNOWN_FLAGS = SNAPSHOT_RNG_STATE;
+//relative rounding error allowed on the stored weights of the groups
+const double SNAPSHOT_WEIGHT_TOLERANCE = 1e-9;
+
+struct SnapshotHeader
+{
+    uint32_t version;
+    uint32_t flags;
+    std::string signature;
+    double min_weight;
+    double max_weight;
+    uint64_t number_of_groups;
+    uint64_t size;
+    std::vector<double> group_weight_vector;
+    uint64_t rng_state;
+    uint64_t rng_increment;
+
+    void write(std::string& buffer) const;
+    static SnapshotHeader read(const char*& cursor, const char* begin,
+            const char* end);
+};
+
+//append zeros until the buffer size is aligned
+void pad_snapshot(std::string& buffer);
+
+//move the cursor to the next aligned position
+void skip_snapshot_padding(const char*& cursor, const char* begin,
+        const char* end);
+
+//read the header at the beginning of a snapshot stream
+SnapshotHeader read_snapshot_header(std::istream& stream);
+
+//throw if the stored weight of a group is not the sum of the weights of its
+//elements, up to rounding. Empty groups must have a zero weight.
+void check_snapshot_group_weight(double group_weight, double weight_sum);
+
+//throw if the stored weight of a group is impossible for its number of
+//elements, whose weights are between the bounds of the group
+void check_snapshot_group_bounds(double group_weight, uint64_t group_size,
+        double min_weight, double max_weight);
+
+}//end of namespace sset
+
+#endif /* SNAPSHOT_HPP_ */
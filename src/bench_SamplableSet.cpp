@@ -0,0 +1,423 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Microbenchmarks of the C++ core. The operations of SamplableSet are timed
+ * for several numbers of elements, weight ranges (numbers of groups), weight
+ * distributions and key types, and the results are written as JSON or CSV.
+ *
+ * Usage: samplableset_bench [--quick] [--csv] [--repeat n] [--seed n]
+ *                           [--output path]
+ */
+
+#include "SamplableSet.hpp"
+#include "hash_specialization.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+using namespace sset;
+
+namespace
+{//start of unnamed namespace
+
+typedef tuple<int,int> Tuple2Int;
+
+//Distributions of the weights between the minimal and maximal weights
+enum WeightDistribution {UNIFORM, LOG_UNIFORM, POWER_LAW};
+const WeightDistribution DISTRIBUTIONS[] = {UNIFORM, LOG_UNIFORM, POWER_LAW};
+
+const char* distribution_name(WeightDistribution distribution)
+{
+    switch (distribution)
+    {
+        case UNIFORM: return "uniform";
+        case LOG_UNIFORM: return "log_uniform";
+        default: return "power_law";
+    }
+}
+
+//draw weights in [min_weight, max_weight], the power law has density w^-2
+vector<double> draw_weights(WeightDistribution distribution, size_t n,
+        double min_weight, double max_weight, RNGType& gen)
+{
+    uniform_real_distribution<double> random_01(0., 1.);
+    vector<double> weight_vector(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        double u = random_01(gen);
+        double weight;
+        switch (distribution)
+        {
+            case UNIFORM:
+                weight = min_weight + u*(max_weight - min_weight);
+                break;
+            case LOG_UNIFORM:
+                weight = min_weight*pow(max_weight/min_weight, u);
+                break;
+            default:
+                weight = 1./(1./min_weight - u*(1./min_weight
+                            - 1./max_weight));
+        }
+        weight_vector[i] = min(max(weight, min_weight), max_weight);
+    }
+    return weight_vector;
+}
+
+//Keys of the benchmarked sets, built before timing
+template <typename T>
+struct BenchKey;
+
+template <>
+struct BenchKey<int>
+{
+    static const char* name() {return "int";}
+    static int make(size_t i) {return static_cast<int>(i);}
+};
+
+template <>
+struct BenchKey<uint64_t>
+{
+    //spread over the whole range like hashes or ids
+    static const char* name() {return "uint64";}
+    static uint64_t make(size_t i) {return i*0x9E3779B97F4A7C15ULL;}
+};
+
+template <>
+struct BenchKey<Tuple2Int>
+{
+    static const char* name() {return "2int";}
+    static Tuple2Int make(size_t i)
+        {return Tuple2Int(static_cast<int>(i % 1000),
+                static_cast<int>(i / 1000));}
+};
+
+template <>
+struct BenchKey<string>
+{
+    static const char* name() {return "str";}
+    static string make(size_t i) {return "element_" + to_string(i);}
+};
+
+struct BenchConfig
+{
+    vector<size_t> size_vector;
+    vector<pair<double,double> > weight_range_vector;
+    size_t repeat;
+    unsigned int seed;
+    bool csv;
+    string output;
+};
+
+struct BenchResult
+{
+    string key_type;
+    string distribution;
+    string operation;
+    size_t size;
+    double min_weight;
+    double max_weight;
+    size_t number_of_groups;
+    double best_ns; //best time per operation over the repetitions
+    double mean_ns; //mean time per operation over the repetitions
+};
+
+//Times of one repetition, in nanoseconds per operation
+struct BenchTiming
+{
+    string operation;
+    double ns;
+};
+
+template <typename Function>
+double time_per_operation(Function function, size_t operations)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    function();
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(stop - start).count()
+        / max(operations, size_t(1));
+}
+
+//time every operation once on a set built from the keys and weights
+template <typename T>
+vector<BenchTiming> run_repetition(const vector<T>& key_vector,
+        const vector<double>& weight_vector,
+        const vector<double>& new_weight_vector,
+        const vector<size_t>& erase_order, double min_weight,
+        double max_weight, size_t& number_of_groups, double& checksum)
+{
+    size_t n = key_vector.size();
+    vector<BenchTiming> timing_vector;
+    SamplableSet<T> samplable_set(min_weight, max_weight);
+    number_of_groups = samplable_set.number_of_groups();
+
+    timing_vector.push_back({"insert", time_per_operation([&]()
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                samplable_set.insert(key_vector[i], weight_vector[i]);
+            }
+        }, n)});
+
+    timing_vector.push_back({"set_weight", time_per_operation([&]()
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                samplable_set.set_weight(key_vector[i],
+                        new_weight_vector[i]);
+            }
+        }, n)});
+
+    timing_vector.push_back({"sample", time_per_operation([&]()
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                checksum += samplable_set.sample().second;
+            }
+        }, n)});
+
+    timing_vector.push_back({"iterate", time_per_operation([&]()
+        {
+            for (const pair<T,double>& element : samplable_set)
+            {
+                checksum += element.second;
+            }
+        }, n)});
+
+    unique_ptr<SamplableSet<T> > set_copy;
+    timing_vector.push_back({"copy", time_per_operation([&]()
+        {
+            set_copy.reset(new SamplableSet<T>(samplable_set));
+        }, n)});
+
+    timing_vector.push_back({"erase", time_per_operation([&]()
+        {
+            for (size_t i : erase_order)
+            {
+                set_copy->erase(key_vector[i]);
+            }
+        }, n)});
+    checksum += set_copy->size();
+
+    timing_vector.push_back({"clear", time_per_operation([&]()
+        {
+            samplable_set.clear();
+        }, n)});
+    checksum += samplable_set.size();
+    return timing_vector;
+}
+
+//run all the configurations for one key type
+template <typename T>
+void run_key_type(const BenchConfig& config, vector<BenchResult>& results,
+        double& checksum)
+{
+    RNGType gen(config.seed);
+    for (size_t n : config.size_vector)
+    {
+        vector<T> key_vector(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            key_vector[i] = BenchKey<T>::make(i);
+        }
+        vector<size_t> erase_order(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            erase_order[i] = i;
+        }
+        shuffle(erase_order.begin(), erase_order.end(), gen);
+
+        for (const pair<double,double>& weight_range :
+                config.weight_range_vector)
+        {
+            for (WeightDistribution distribution : DISTRIBUTIONS)
+            {
+                vector<double> weight_vector = draw_weights(distribution,
+                        n, weight_range.first, weight_range.second, gen);
+                vector<double> new_weight_vector = draw_weights(distribution,
+                        n, weight_range.first, weight_range.second, gen);
+
+                size_t first_result = results.size();
+                for (size_t r = 0; r < config.repeat; r++)
+                {
+                    size_t number_of_groups = 0;
+                    vector<BenchTiming> timing_vector = run_repetition(
+                            key_vector, weight_vector, new_weight_vector,
+                            erase_order, weight_range.first,
+                            weight_range.second, number_of_groups,
+                            checksum);
+                    for (size_t j = 0; j < timing_vector.size(); j++)
+                    {
+                        if (r == 0)
+                        {
+                            results.push_back({BenchKey<T>::name(),
+                                distribution_name(distribution),
+                                timing_vector[j].operation, n,
+                                weight_range.first, weight_range.second,
+                                number_of_groups, timing_vector[j].ns, 0.});
+                        }
+                        BenchResult& result = results[first_result + j];
+                        result.best_ns = min(result.best_ns,
+                                timing_vector[j].ns);
+                        result.mean_ns += timing_vector[j].ns/config.repeat;
+                    }
+                }
+                cerr << BenchKey<T>::name() << " n=" << n << " weights=["
+                    << weight_range.first << "," << weight_range.second
+                    << "] " << distribution_name(distribution) << " done"
+                    << endl;
+            }
+        }
+    }
+}
+
+void write_csv(ostream& out, const vector<BenchResult>& results)
+{
+    out << "key_type,distribution,operation,size,min_weight,max_weight,"
+        << "number_of_groups,best_ns,mean_ns\n";
+    for (const BenchResult& result : results)
+    {
+        out << result.key_type << ',' << result.distribution << ','
+            << result.operation << ',' << result.size << ','
+            << result.min_weight << ',' << result.max_weight << ','
+            << result.number_of_groups << ',' << result.best_ns << ','
+            << result.mean_ns << '\n';
+    }
+}
+
+void write_json(ostream& out, const BenchConfig& config,
+        const vector<BenchResult>& results)
+{
+    out << "{\n  \"benchmark\": \"samplableset\",\n"
+        << "  \"repeat\": " << config.repeat << ",\n"
+        << "  \"seed\": " << config.seed << ",\n"
+        << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult& result = results[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"key_type\": \"" << result.key_type
+            << "\", \"distribution\": \"" << result.distribution
+            << "\", \"operation\": \"" << result.operation
+            << "\", \"size\": " << result.size
+            << ", \"min_weight\": " << result.min_weight
+            << ", \"max_weight\": " << result.max_weight
+            << ", \"number_of_groups\": " << result.number_of_groups
+            << ", \"best_ns\": " << result.best_ns
+            << ", \"mean_ns\": " << result.mean_ns << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+BenchConfig parse_arguments(int argc, char* argv[])
+{
+    BenchConfig config{{1000, 10000, 100000, 1000000},
+        {{1., 2.}, {1., 1e3}, {1., 1e6}}, 3, 42, false, ""};
+    for (int i = 1; i < argc; i++)
+    {
+        string argument(argv[i]);
+        bool has_value = i + 1 < argc;
+        if (argument == "--quick")
+        {
+            config.size_vector = {1000, 10000};
+        }
+        else if (argument == "--csv")
+        {
+            config.csv = true;
+        }
+        else if (argument == "--repeat" and has_value)
+        {
+            config.repeat = max<size_t>(strtoul(argv[++i], nullptr, 10), 1);
+        }
+        else if (argument == "--seed" and has_value)
+        {
+            config.seed = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (argument == "--output" and has_value)
+        {
+            config.output = argv[++i];
+        }
+        else
+        {
+            throw invalid_argument("Unknown argument " + argument);
+        }
+    }
+    return config;
+}
+
+}//end of unnamed namespace
+
+int main(int argc, char* argv[])
+{
+    BenchConfig config;
+    try
+    {
+        config = parse_arguments(argc, argv);
+    }
+    catch (const invalid_argument& error)
+    {
+        cerr << error.what() << "\nUsage: samplableset_bench [--quick] "
+            << "[--csv] [--repeat n] [--seed n] [--output path]" << endl;
+        return 1;
+    }
+
+    BaseSamplableSet::seed(config.seed);
+    vector<BenchResult> results;
+    double checksum = 0; //keeps the sampled weights alive
+    run_key_type<int>(config, results, checksum);
+    run_key_type<uint64_t>(config, results, checksum);
+    run_key_type<Tuple2Int>(config, results, checksum);
+    run_key_type<string>(config, results, checksum);
+    cerr << "checksum " << checksum << endl;
+
+    ofstream file;
+    if (not config.output.empty())
+    {
+        file.open(config.output);
+        if (not file)
+        {
+            cerr << "Cannot open " << config.output << endl;
+            return 1;
+        }
+    }
+    ostream& out = config.output.empty() ? cout : file;
+    if (config.csv)
+    {
+        write_csv(out, results);
+    }
+    else
+    {
+        write_json(out, config, results);
+    }
+    return 0;
+}
@@ -24,8 +24,20 @@
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include <SamplableSet.hpp>
+#include <MappedSamplableSet.hpp>
+#include <Loader.hpp>
+#include <SharedSamplableSet.hpp>
+#include <NestedSamplableSet.hpp>
+#include <Gillespie.hpp>
 #include <hash_specialization.hpp>
+#include <PyKey.hpp>
+#include <functional>
+#include <mutex>
+#include <memory>
+#include <fstream>
+#include <limits>
 
 using namespace std;
 using namespace sset;
@@ -37,13 +49,907 @@ typedef tuple<int,int,int> Tuple3Int;
 typedef tuple<string,string> Tuple2String;
 typedef tuple<string,string,string> Tuple3String;
 
-//template function to declare different types of samplable set
+//Thread safety: the GIL is released in the bindings that do not touch
+//python objects. Each set is then locked during the call, and the shared
+//RNG as well if random numbers are drawn. Locks are always acquired with
+//the GIL released to avoid deadlocks.
+
+//wrap a method so that it is called with the set locked
+template<typename Set, typename Return, typename... Args>
+function<Return(Set&, Args...)> locked(Return (Set::*method)(Args...))
+{
+    return [method](Set& set, Args... args)
+    {
+        lock_guard<recursive_mutex> lock(set.mutex());
+        return (set.*method)(args...);
+    };
+}
+
+template<typename Set, typename Return, typename... Args>
+function<Return(const Set&, Args...)> locked(
+        Return (Set::*method)(Args...) const)
+{
+    return [method](const Set& set, Args... args)
+    {
+        lock_guard<recursive_mutex> lock(set.mutex());
+        return (set.*method)(args...);
+    };
+}
+
+//wrap a method so that it is called with the set and the RNG locked
+template<typename Set, typename Return, typename... Args>
+function<Return(Set&, Args...)> locked_random(
+        Return (Set::*method)(Args...))
+{
+    return [method](Set& set, Args... args)
+    {
+        lock_guard<recursive_mutex> lock(set.mutex());
+        lock_guard<recursive_mutex> rng_lock(BaseSamplableSet::rng_mutex());
+        return (set.*method)(args...);
+    };
+}
+
+template<typename Set, typename Return, typename... Args>
+function<Return(const Set&, Args...)> locked_random(
+        Return (Set::*method)(Args...) const)
+{
+    return [method](const Set& set, Args... args)
+    {
+        lock_guard<recursive_mutex> lock(set.mutex());
+        lock_guard<recursive_mutex> rng_lock(BaseSamplableSet::rng_mutex());
+        return (set.*method)(args...);
+    };
+}
+
+//copy a set with the GIL released and the copied set locked
+template<typename Set>
+Set* locked_copy(const Set& set)
+{
+    py::gil_scoped_release release;
+    lock_guard<recursive_mutex> lock(set.mutex());
+    return new Set(set);
+}
+
+//seed the shared RNG
+void locked_seed(unsigned int seed_value)
+{
+    lock_guard<recursive_mutex> rng_lock(BaseSamplableSet::rng_mutex());
+    BaseSamplableSet::seed(seed_value);
+}
+
+//state of the shared RNG as a pair (state, increment)
+pair<uint64_t, uint64_t> locked_rng_state()
+{
+    lock_guard<recursive_mutex> rng_lock(BaseSamplableSet::rng_mutex());
+    RNGState state = BaseSamplableSet::rng_state();
+    return make_pair(state.state, state.increment);
+}
+
+//restore a state of the shared RNG given by locked_rng_state
+void locked_set_rng_state(pair<uint64_t, uint64_t> state)
+{
+    lock_guard<recursive_mutex> rng_lock(BaseSamplableSet::rng_mutex());
+    BaseSamplableSet::set_rng_state(RNGState{state.first, state.second});
+}
+
+//acquire the lock of a set with the GIL released
+template<typename Set>
+unique_lock<recursive_mutex> lock_set(const Set& set)
+{
+    py::gil_scoped_release release;
+    return unique_lock<recursive_mutex>(set.mutex());
+}
+
+//acquire the lock of the shared RNG with the GIL released
+unique_lock<recursive_mutex> lock_rng()
+{
+    py::gil_scoped_release release;
+    return unique_lock<recursive_mutex>(BaseSamplableSet::rng_mutex());
+}
+
+//wrap a method of a set of python objects so that it is called with the set
+//locked and the GIL held. The GIL does not serialize the calls, since the
+//__eq__ of the keys can switch threads in the middle of a modification.
+template<typename Set, typename Return, typename... Args>
+function<Return(Set&, Args...)> locked_with_gil(
+        Return (Set::*method)(Args...))
+{
+    return [method](Set& set, Args... args)
+    {
+        unique_lock<recursive_mutex> lock = lock_set(set);
+        return (set.*method)(args...);
+    };
+}
+
+template<typename Set, typename Return, typename... Args>
+function<Return(const Set&, Args...)> locked_with_gil(
+        Return (Set::*method)(Args...) const)
+{
+    return [method](const Set& set, Args... args)
+    {
+        unique_lock<recursive_mutex> lock = lock_set(set);
+        return (set.*method)(args...);
+    };
+}
+
+//instrumentation counters of a set as a dict, zeros if they are not compiled
+template<typename T, typename Index>
+py::dict counters(const SamplableSet<T,Index>& samplable_set)
+{
+    InstrumentationCounters counters;
+    {
+        unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+        counters = samplable_set.counters();
+    }
+    py::dict counter_dict;
+    counter_dict["samples"] = counters.samples;
+    counter_dict["rejection_trials"] = counters.rejection_trials;
+    counter_dict["group_changes"] = counters.group_changes;
+    counter_dict["tree_node_visits"] = counters.tree_node_visits;
+    counter_dict["hash_probes"] = counters.hash_probes;
+    return counter_dict;
+}
+
+//bytes used by the components of a set as a dict, with their total
+template<typename T, typename Index>
+py::dict memory_usage(const SamplableSet<T,Index>& samplable_set)
+{
+    MemoryUsage usage;
+    {
+        unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+        usage = samplable_set.memory_usage();
+    }
+    py::dict usage_dict;
+    usage_dict["object"] = usage.object;
+    usage_dict["position_map_buckets"] = usage.position_map_buckets;
+    usage_dict["position_map_nodes"] = usage.position_map_nodes;
+    usage_dict["group_elements"] = usage.group_elements;
+    usage_dict["group_slack"] = usage.group_slack;
+    usage_dict["group_vectors"] = usage.group_vectors;
+    usage_dict["tree_nodes"] = usage.tree_nodes;
+    usage_dict["tree_leaves"] = usage.tree_leaves;
+    usage_dict["total"] = usage.total();
+    return usage_dict;
+}
+
+//conversion of numerical keys from and to the rows of numpy arrays
+template<typename T, typename Enable = void>
+struct NumpyKey;
+
+template<typename T>
+struct NumpyKey<T, typename enable_if<is_arithmetic<T>::value>::type>
+{
+    typedef T Scalar;
+    static const size_t width = 1;
+    static T read(const Scalar* row) {return row[0];}
+    static void write(const T& key, Scalar* row) {row[0] = key;}
+    static const Scalar* field(const T& key, size_t) {return &key;}
+};
+
+template<>
+struct NumpyKey<Tuple2Int>
+{
+    typedef int Scalar;
+    static const size_t width = 2;
+    static Tuple2Int read(const Scalar* row)
+        {return Tuple2Int(row[0], row[1]);}
+    static void write(const Tuple2Int& key, Scalar* row)
+        {row[0] = get<0>(key); row[1] = get<1>(key);}
+    static const Scalar* field(const Tuple2Int& key, size_t j)
+        {return (j == 0) ? &get<0>(key) : &get<1>(key);}
+};
+
+template<>
+struct NumpyKey<Tuple3Int>
+{
+    typedef int Scalar;
+    static const size_t width = 3;
+    static Tuple3Int read(const Scalar* row)
+        {return Tuple3Int(row[0], row[1], row[2]);}
+    static void write(const Tuple3Int& key, Scalar* row)
+        {row[0] = get<0>(key); row[1] = get<1>(key); row[2] = get<2>(key);}
+    static const Scalar* field(const Tuple3Int& key, size_t j)
+        {return (j == 0) ? &get<0>(key) : (j == 1) ? &get<1>(key) :
+            &get<2>(key);}
+};
+
+//true for the keys with a NumpyKey conversion
+template<typename T>
+struct is_numpy_key : is_arithmetic<T> {};
+
+template<>
+struct is_numpy_key<Tuple2Int> : true_type {};
+
+template<>
+struct is_numpy_key<Tuple3Int> : true_type {};
+
+//allocate an array for n keys, of shape (n,) or (n, k) for tuples
+template<typename T>
+py::array_t<typename NumpyKey<T>::Scalar> new_key_array(size_t n)
+{
+    vector<size_t> shape(1, n);
+    if (NumpyKey<T>::width > 1)
+    {
+        shape.push_back(NumpyKey<T>::width);
+    }
+    return py::array_t<typename NumpyKey<T>::Scalar>(shape);
+}
+
+//convert a vector to a numpy array for numerical keys, to a list otherwise
+template<typename T>
+py::object to_python_array(const vector<T>& vec, true_type)
+{
+    py::array_t<typename NumpyKey<T>::Scalar> array = new_key_array<T>(
+            vec.size());
+    typename NumpyKey<T>::Scalar* key_ptr = array.mutable_data();
+    for (size_t i = 0; i < vec.size(); i++)
+    {
+        NumpyKey<T>::write(vec[i], key_ptr + i*NumpyKey<T>::width);
+    }
+    return array;
+}
+
+template<typename T>
+py::object to_python_array(const vector<T>& vec, false_type)
+{
+    return py::cast(vec);
+}
+
+template<typename T>
+py::object to_python_array(const vector<T>& vec)
+{
+    return to_python_array(vec, is_numpy_key<T>());
+}
+
+//convert a dict {fired: [(element, value) or (element, value, mode)]} to a
+//reaction table, the mode is 'set' (default) or 'add'
+template<typename T>
+ReactionTable<T> to_reaction_table(py::dict changes)
+{
+    ReactionTable<T> table;
+    for (auto item : changes)
+    {
+        T fired = item.first.cast<T>();
+        for (py::handle change : item.second)
+        {
+            py::tuple change_tuple = change.cast<py::tuple>();
+            if (change_tuple.size() != 2 and change_tuple.size() != 3)
+            {
+                throw invalid_argument("A weight change must be a tuple "
+                        "(element, value) or (element, value, mode)");
+            }
+            bool relative = false;
+            if (change_tuple.size() == 3)
+            {
+                string mode = change_tuple[2].cast<string>();
+                if (mode != "set" and mode != "add")
+                {
+                    throw invalid_argument("The mode of a weight change "
+                            "must be 'set' or 'add'");
+                }
+                relative = (mode == "add");
+            }
+            table.add_change(fired, change_tuple[0].cast<T>(),
+                    change_tuple[1].cast<double>(), relative);
+        }
+    }
+    return table;
+}
+
+//run a simulation engine on a set with a built-in, tabulated or python
+//update rule
+template<typename T, typename Set, typename Engine>
+EventLog<T> run_simulation(Engine& engine, Set& set, size_t max_events,
+        double max_time, py::object update)
+{
+    bool no_update = update.is_none();
+    bool erase_fired = py::isinstance<py::str>(update) and
+        update.cast<string>() == "erase";
+    bool tabulated = py::isinstance<py::dict>(update);
+    if (not no_update and not erase_fired and not tabulated and
+            not PyCallable_Check(update.ptr()))
+    {
+        throw invalid_argument("The update rule must be None, 'erase', "
+                "a dict or a callable");
+    }
+    ReactionTable<T> table;
+    if (tabulated)
+    {
+        table = to_reaction_table<T>(update.cast<py::dict>());
+    }
+    EventLog<T> log;
+    py::gil_scoped_release release;
+    lock_guard<recursive_mutex> set_lock(set.mutex());
+    unique_lock<recursive_mutex> rng_lock(BaseSamplableSet::rng_mutex());
+    if (no_update)
+    {
+        log = engine.run(set, NoUpdate(), max_events, max_time);
+    }
+    else if (erase_fired)
+    {
+        log = engine.run(set, EraseFired(), max_events, max_time);
+    }
+    else if (tabulated)
+    {
+        log = engine.run(set, cref(table), max_events, max_time);
+    }
+    else
+    {
+        //the set lock is recursive, the update rule can modify the set; the
+        //RNG is unlocked while python code runs and locked again without the
+        //GIL, like every lock of the module
+        log = engine.run(set, [&update, &rng_lock](const T& element, Set&)
+                {
+                    rng_lock.unlock();
+                    {
+                        py::gil_scoped_acquire acquire;
+                        update(element);
+                    }
+                    rng_lock.lock();
+                }, max_events, max_time);
+    }
+    return log;
+}
+
+//run the direct method on a samplable set
+template<typename T, typename Index>
+py::tuple gillespie(SamplableSet<T,Index>& samplable_set, size_t max_events,
+        double max_time, double time, py::object update)
+{
+    DirectMethod<T> engine(time);
+    EventLog<T> log = run_simulation<T>(engine, samplable_set, max_events,
+            max_time, update);
+    return py::make_tuple(to_python_array(log.time),
+            to_python_array(log.element), engine.time());
+}
+
+//run the next reaction method on a next reaction set
+template<typename T>
+py::tuple next_reaction(NextReactionSet<T>& next_reaction_set,
+        size_t max_events, double max_time, py::object update)
+{
+    NextReactionMethod<T> engine;
+    EventLog<T> log = run_simulation<T>(engine, next_reaction_set, max_events,
+            max_time, update);
+    return py::make_tuple(to_python_array(log.time),
+            to_python_array(log.element), next_reaction_set.time());
+}
+
+//array of keys, built by to_key_array which checks the conversion
+template<typename T>
+using KeyArray = py::array_t<typename NumpyKey<T>::Scalar,
+      py::array::c_style | py::array::forcecast>;
+typedef py::array_t<double, py::array::c_style | py::array::forcecast>
+    WeightArray;
+
+//convert keys to the integer type of the elements without changing them:
+//arrays which are not of integers raise a TypeError, and keys out of the
+//range of the type an OverflowError
+template<typename T>
+KeyArray<T> to_key_array(py::object key_object)
+{
+    typedef typename NumpyKey<T>::Scalar Scalar;
+    py::array keys = py::array::ensure(key_object);
+    if (not keys)
+    {
+        throw py::type_error("The keys must be an array of integers");
+    }
+    char kind = keys.dtype().attr("kind").cast<string>()[0];
+    if (kind != 'i' and kind != 'u')
+    {
+        throw py::type_error("The keys must be an array of integers, not "
+                + py::str(keys.dtype()).cast<string>());
+    }
+    if (keys.size() > 0 and not py::isinstance<py::array_t<Scalar> >(keys))
+    {
+        bool in_range;
+        uint64_t scalar_max = numeric_limits<Scalar>::max();
+        if (kind == 'i')
+        {
+            int64_t min_key = keys.attr("min")().cast<int64_t>();
+            int64_t max_key = keys.attr("max")().cast<int64_t>();
+            in_range = (min_key >= 0 or (numeric_limits<Scalar>::is_signed
+                        and min_key >= int64_t(numeric_limits<Scalar>::min())))
+                and (max_key < 0 or uint64_t(max_key) <= scalar_max);
+        }
+        else
+        {
+            in_range = keys.attr("max")().cast<uint64_t>() <= scalar_max;
+        }
+        if (not in_range)
+        {
+            PyErr_SetString(PyExc_OverflowError, "Keys out of the range of "
+                    "the type of the elements");
+            throw py::error_already_set();
+        }
+    }
+    return KeyArray<T>::ensure(keys);
+}
+
+//throw a invalid_argument error if the arrays of keys and weights do not
+//have compatible shapes
+template<typename T>
+void array_checkup(const KeyArray<T>& keys, const WeightArray& weights)
+{
+    size_t width = NumpyKey<T>::width;
+    bool valid_keys = (width == 1) ? keys.ndim() == 1 :
+        (keys.ndim() == 2 and size_t(keys.shape(1)) == width);
+    if (not valid_keys)
+    {
+        throw invalid_argument("The keys must be an array of shape (N,) "
+                "for int elements or (N, k) for tuples of k int");
+    }
+    if (weights.ndim() != 1 or weights.shape(0) != keys.shape(0))
+    {
+        throw invalid_argument("The weights must be an array of shape (N,)");
+    }
+}
+
+//insert the elements of an array with their associated weights
+template<typename T, typename Index>
+void insert_array(SamplableSet<T,Index>& samplable_set,
+        py::object key_object, const WeightArray& weights)
+{
+    KeyArray<T> keys = to_key_array<T>(key_object);
+    array_checkup<T>(keys, weights);
+    const typename NumpyKey<T>::Scalar* key_ptr = keys.data();
+    const double* weight_ptr = weights.data();
+    size_t n = weights.shape(0);
+    py::gil_scoped_release release;
+    lock_guard<recursive_mutex> lock(samplable_set.mutex());
+    for (size_t i = 0; i < n; i++)
+    {
+        samplable_set.insert(NumpyKey<T>::read(key_ptr + i*NumpyKey<T>::width),
+                weight_ptr[i]);
+    }
+}
+
+//set the weights of the elements of an array
+template<typename T, typename Index>
+void set_weight_array(SamplableSet<T,Index>& samplable_set,
+        py::object key_object, const WeightArray& weights)
+{
+    KeyArray<T> keys = to_key_array<T>(key_object);
+    array_checkup<T>(keys, weights);
+    const typename NumpyKey<T>::Scalar* key_ptr = keys.data();
+    const double* weight_ptr = weights.data();
+    size_t n = weights.shape(0);
+    py::gil_scoped_release release;
+    lock_guard<recursive_mutex> lock(samplable_set.mutex());
+    for (size_t i = 0; i < n; i++)
+    {
+        samplable_set.set_weight(
+                NumpyKey<T>::read(key_ptr + i*NumpyKey<T>::width),
+                weight_ptr[i]);
+    }
+}
+
+//operations of a command buffer
+enum Command : uint8_t
+{
+    INSERT_COMMAND = 0,
+    SET_WEIGHT_COMMAND = 1,
+    ERASE_COMMAND = 2,
+    SAMPLE_COMMAND = 3,
+    GET_WEIGHT_COMMAND = 4
+};
+
+typedef py::array_t<uint8_t, py::array::c_style | py::array::forcecast>
+    CommandArray;
+
+//run a buffer of commands in order. The output arrays hold the sampled
+//elements and weights for samples, and the weight of the element before the
+//command otherwise (NaN if it was not in the set), given by the lookup done
+//by the command itself.
+template<typename T, typename Index>
+py::tuple execute(SamplableSet<T,Index>& samplable_set,
+        const CommandArray& commands, py::object key_object,
+        const WeightArray& weights)
+{
+    KeyArray<T> keys = to_key_array<T>(key_object);
+    array_checkup<T>(keys, weights);
+    if (commands.ndim() != 1 or commands.shape(0) != weights.shape(0))
+    {
+        throw invalid_argument("The commands must be an array of shape (N,)");
+    }
+    size_t n = weights.shape(0);
+    unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+    unique_lock<recursive_mutex> rng_lock = lock_rng();
+    py::array_t<typename NumpyKey<T>::Scalar> output_keys =
+        new_key_array<T>(n);
+    py::array_t<double> output_weights(n);
+    const uint8_t* command_ptr = commands.data();
+    const typename NumpyKey<T>::Scalar* key_ptr = keys.data();
+    const double* weight_ptr = weights.data();
+    typename NumpyKey<T>::Scalar* output_key_ptr = output_keys.mutable_data();
+    double* output_weight_ptr = output_weights.mutable_data();
+    {
+        py::gil_scoped_release release;
+        for (size_t i = 0; i < n; i++)
+        {
+            size_t offset = i*NumpyKey<T>::width;
+            T element = NumpyKey<T>::read(key_ptr + offset);
+            double weight = numeric_limits<double>::quiet_NaN();
+            switch (command_ptr[i])
+            {
+                case INSERT_COMMAND:
+                    samplable_set.try_insert(element, weight_ptr[i], weight);
+                    break;
+                case SET_WEIGHT_COMMAND:
+                    if (not samplable_set.update_weight(element, weight_ptr[i],
+                                weight))
+                    {
+                        samplable_set.insert(element, weight_ptr[i]);
+                    }
+                    break;
+                case ERASE_COMMAND:
+                    samplable_set.extract(element, weight);
+                    break;
+                case SAMPLE_COMMAND:
+                {
+                    pair<T,double> element_weight_pair =
+                        samplable_set.sample();
+                    element = element_weight_pair.first;
+                    weight = element_weight_pair.second;
+                    break;
+                }
+                case GET_WEIGHT_COMMAND:
+                    samplable_set.find_weight(element, weight);
+                    break;
+                default:
+                    throw invalid_argument("Unknown command "
+                            + to_string(command_ptr[i]));
+            }
+            NumpyKey<T>::write(element, output_key_ptr + offset);
+            output_weight_ptr[i] = weight;
+        }
+    }
+    return py::make_tuple(output_keys, output_weights);
+}
+
+//draw n elements with replacement, the keys are written in an array
+template<typename T, typename Index>
+py::tuple sample_n(const SamplableSet<T,Index>& samplable_set, size_t n,
+        true_type)
+{
+    unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+    unique_lock<recursive_mutex> rng_lock = lock_rng();
+    py::array_t<typename NumpyKey<T>::Scalar> keys = new_key_array<T>(n);
+    py::array_t<double> weights(n);
+    typename NumpyKey<T>::Scalar* key_ptr = keys.mutable_data();
+    double* weight_ptr = weights.mutable_data();
+    {
+        py::gil_scoped_release release;
+        for (size_t i = 0; i < n; i++)
+        {
+            pair<T,double> element_weight_pair = samplable_set.sample();
+            NumpyKey<T>::write(element_weight_pair.first,
+                    key_ptr + i*NumpyKey<T>::width);
+            weight_ptr[i] = element_weight_pair.second;
+        }
+    }
+    return py::make_tuple(keys, weights);
+}
+
+//draw n elements with replacement, the keys are returned in a list
+template<typename T, typename Index>
+py::tuple sample_n(const SamplableSet<T,Index>& samplable_set, size_t n,
+        false_type)
+{
+    unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+    unique_lock<recursive_mutex> rng_lock = lock_rng();
+    vector<T> keys;
+    py::array_t<double> weights(n);
+    double* weight_ptr = weights.mutable_data();
+    {
+        py::gil_scoped_release release;
+        keys.reserve(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            pair<T,double> element_weight_pair = samplable_set.sample();
+            keys.push_back(element_weight_pair.first);
+            weight_ptr[i] = element_weight_pair.second;
+        }
+    }
+    return py::make_tuple(py::cast(keys), weights);
+}
+
+template<typename T, typename Index>
+py::tuple sample_n(const SamplableSet<T,Index>& samplable_set, size_t n)
+{
+    return sample_n(samplable_set, n, is_numpy_key<T>());
+}
+
+//occupancy of the groups as a dict of arrays indexed by group
+template<typename T, typename Index>
+py::dict group_stats(const SamplableSet<T,Index>& samplable_set)
+{
+    GroupStats stats;
+    {
+        unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+        stats = samplable_set.group_stats();
+    }
+    vector<uint64_t> size(stats.size.begin(), stats.size.end());
+    py::dict stats_dict;
+    stats_dict["size"] = py::array_t<uint64_t>(size.size(), size.data());
+    stats_dict["weight"] = py::array_t<double>(stats.weight.size(),
+            stats.weight.data());
+    stats_dict["bound"] = py::array_t<double>(stats.bound.size(),
+            stats.bound.data());
+    stats_dict["acceptance"] = py::array_t<double>(stats.acceptance.size(),
+            stats.acceptance.data());
+    return stats_dict;
+}
+
+//copy of the weights of a group, made through a view while the set is
+//locked, so that it stays valid after the set is modified
+template<typename T, typename Index>
+py::array group_weights(py::object self, GroupIndex group_index)
+{
+    const SamplableSet<T,Index>& samplable_set =
+        self.cast<const SamplableSet<T,Index>&>();
+    unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+    const typename SamplableSet<T,Index>::PropensityGroup& group =
+        samplable_set.get_group(group_index);
+    py::array_t<double> view(vector<size_t>(1, group.size()),
+            vector<size_t>(1, sizeof(pair<T,double>)),
+            group.empty() ? nullptr : &group.front().second, self);
+    return view.attr("copy")();
+}
+
+//copy of the keys of a group, made through a view while the set is locked
+template<typename T, typename Index>
+py::array group_keys(py::object self, GroupIndex group_index)
+{
+    typedef typename NumpyKey<T>::Scalar Scalar;
+    const SamplableSet<T,Index>& samplable_set =
+        self.cast<const SamplableSet<T,Index>&>();
+    unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+    const typename SamplableSet<T,Index>::PropensityGroup& group =
+        samplable_set.get_group(group_index);
+    vector<size_t> shape(1, group.size());
+    vector<ptrdiff_t> strides(1, sizeof(pair<T,double>));
+    const Scalar* key_ptr = nullptr;
+    if (not group.empty())
+    {
+        //the fields of a tuple may be stored in reverse order
+        const T& key = group.front().first;
+        key_ptr = NumpyKey<T>::field(key, 0);
+        if (NumpyKey<T>::width > 1)
+        {
+            ptrdiff_t field_stride = (const char*) NumpyKey<T>::field(key, 1)
+                - (const char*) key_ptr;
+            for (size_t j = 2; j < NumpyKey<T>::width; j++)
+            {
+                if ((const char*) NumpyKey<T>::field(key, j) -
+                        (const char*) NumpyKey<T>::field(key, j-1) !=
+                        field_stride)
+                {
+                    throw runtime_error("The fields of the keys are not "
+                            "evenly spaced");
+                }
+            }
+            shape.push_back(NumpyKey<T>::width);
+            strides.push_back(field_stride);
+        }
+    }
+    else if (NumpyKey<T>::width > 1)
+    {
+        shape.push_back(NumpyKey<T>::width);
+        strides.push_back(sizeof(Scalar));
+    }
+    py::array_t<Scalar> view(shape, strides, key_ptr, self);
+    return view.attr("copy")();
+}
+
+//copy the elements and weights of the set in contiguous arrays
+template<typename T, typename Index>
+py::tuple to_arrays(const SamplableSet<T,Index>& samplable_set, true_type)
+{
+    unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+    py::array_t<typename NumpyKey<T>::Scalar> keys = new_key_array<T>(
+            samplable_set.size());
+    py::array_t<double> weights(samplable_set.size());
+    typename NumpyKey<T>::Scalar* key_ptr = keys.mutable_data();
+    double* weight_ptr = weights.mutable_data();
+    {
+        py::gil_scoped_release release;
+        for (GroupIndex group_index = 0;
+                group_index < samplable_set.number_of_groups(); group_index++)
+        {
+            for (const auto& element_weight_pair :
+                    samplable_set.get_group(group_index))
+            {
+                NumpyKey<T>::write(element_weight_pair.first, key_ptr);
+                key_ptr += NumpyKey<T>::width;
+                *weight_ptr = element_weight_pair.second;
+                weight_ptr += 1;
+            }
+        }
+    }
+    return py::make_tuple(keys, weights);
+}
+
+//copy the elements in a list and the weights in a contiguous array
+template<typename T, typename Index>
+py::tuple to_arrays(const SamplableSet<T,Index>& samplable_set, false_type)
+{
+    unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+    py::list keys(samplable_set.size());
+    py::array_t<double> weights(samplable_set.size());
+    double* weight_ptr = weights.mutable_data();
+    size_t i = 0;
+    for (GroupIndex group_index = 0;
+            group_index < samplable_set.number_of_groups(); group_index++)
+    {
+        for (const auto& element_weight_pair :
+                samplable_set.get_group(group_index))
+        {
+            keys[i] = py::cast(element_weight_pair.first);
+            weight_ptr[i] = element_weight_pair.second;
+            i += 1;
+        }
+    }
+    return py::make_tuple(keys, weights);
+}
+
+template<typename T, typename Index>
+py::tuple to_arrays(const SamplableSet<T,Index>& samplable_set)
+{
+    return to_arrays(samplable_set, is_numpy_key<T>());
+}
+
+//split pairs of elements and counts into a tuple of arrays
 template<typename T>
-void declare_samplable_set(py::module &m, string typestr)
+py::tuple to_python_counts(const vector<pair<T,unsigned long> >& pair_vector)
+{
+    vector<T> element_vector;
+    vector<unsigned long> count_vector;
+    element_vector.reserve(pair_vector.size());
+    count_vector.reserve(pair_vector.size());
+    for (const auto& element_count_pair : pair_vector)
+    {
+        element_vector.push_back(element_count_pair.first);
+        count_vector.push_back(element_count_pair.second);
+    }
+    return py::make_tuple(to_python_array(element_vector),
+            to_python_array(count_vector));
+}
+
+//draw the firing counts of the elements during tau
+template<typename T, typename Index>
+py::tuple tau_leap(const SamplableSet<T,Index>& samplable_set, double tau)
+{
+    vector<pair<T,unsigned long> > firing_vector;
+    {
+        py::gil_scoped_release release;
+        lock_guard<recursive_mutex> lock(samplable_set.mutex());
+        lock_guard<recursive_mutex> rng_lock(BaseSamplableSet::rng_mutex());
+        firing_vector = samplable_set.tau_leap(tau);
+    }
+    return to_python_counts(firing_vector);
+}
+
+//draw the number of times each element is sampled in n draws
+template<typename T, typename Index>
+py::tuple sample_counts(const SamplableSet<T,Index>& samplable_set,
+        unsigned long n)
+{
+    vector<pair<T,unsigned long> > count_vector;
+    {
+        py::gil_scoped_release release;
+        lock_guard<recursive_mutex> lock(samplable_set.mutex());
+        lock_guard<recursive_mutex> rng_lock(BaseSamplableSet::rng_mutex());
+        count_vector = samplable_set.sample_counts(n);
+    }
+    return to_python_counts(count_vector);
+}
+
+//draw n python objects with replacement, the GIL being held
+py::tuple sample_n(const SamplableSet<PyKey>& samplable_set, size_t n)
+{
+    unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+    unique_lock<recursive_mutex> rng_lock = lock_rng();
+    py::list keys(n);
+    py::array_t<double> weights(n);
+    double* weight_ptr = weights.mutable_data();
+    for (size_t i = 0; i < n; i++)
+    {
+        pair<PyKey,double> element_weight_pair = samplable_set.sample();
+        keys[i] = element_weight_pair.first.object();
+        weight_ptr[i] = element_weight_pair.second;
+    }
+    return py::make_tuple(keys, weights);
+}
+
+//draw the number of times each python object is sampled in n draws
+py::tuple sample_counts(const SamplableSet<PyKey>& samplable_set,
+        unsigned long n)
+{
+    unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+    unique_lock<recursive_mutex> rng_lock = lock_rng();
+    return to_python_counts(samplable_set.sample_counts(n));
+}
+
+//Iterator over the pairs of elements and weights of a set. Each step locks
+//the set, and a RuntimeError is raised if elements were inserted or erased
+//since the iterator was created, instead of reading moved elements.
+template<typename T, typename Index>
+class CheckedIterator
+{
+public:
+    CheckedIterator(const SamplableSet<T,Index>& samplable_set) :
+        set_(samplable_set),
+        iterator_(samplable_set.begin()),
+        modification_count_(samplable_set.modification_count()) {}
+
+    py::object next()
+    {
+        pair<T,double> element_weight_pair;
+        {
+            unique_lock<recursive_mutex> lock = lock_set(set_);
+            if (set_.modification_count() != modification_count_)
+            {
+                throw runtime_error("The set was modified during the "
+                        "iteration");
+            }
+            if (iterator_ == set_.end())
+            {
+                throw py::stop_iteration();
+            }
+            element_weight_pair = *iterator_;
+            ++iterator_;
+        }
+        return py::cast(element_weight_pair);
+    }
+
+private:
+    const SamplableSet<T,Index>& set_;
+    typename SamplableSet<T,Index>::const_iterator iterator_;
+    uint64_t modification_count_;
+};
+
+//declare the iterator class of a type of set
+template<typename T, typename Index>
+void declare_checked_iterator(py::module &m, string pyclass_name)
+{
+    py::class_<CheckedIterator<T,Index> >(m, pyclass_name.c_str())
+        .def("__iter__", [](py::object self) {return self;})
+        .def("__next__", &CheckedIterator<T,Index>::next);
+}
+
+//binary state of a set used for pickling
+template<typename T, typename Index>
+py::bytes get_state(const SamplableSet<T,Index>& samplable_set)
+{
+    string buffer;
+    {
+        py::gil_scoped_release release;
+        lock_guard<recursive_mutex> lock(samplable_set.mutex());
+        buffer = samplable_set.serialize();
+    }
+    return py::bytes(buffer);
+}
+
+//rebuild a set from its binary state
+template<typename T, typename Index>
+SamplableSet<T,Index>* set_state(const py::bytes& state)
+{
+    string buffer = state;
+    py::gil_scoped_release release;
+    return new SamplableSet<T,Index>(
+            SamplableSet<T,Index>::deserialize(buffer));
+}
+
+//template function to declare different types of samplable set
+template<typename T, typename Index = InGroupIndex>
+py::class_<SamplableSet<T,Index> > declare_samplable_set(py::module &m,
+        string typestr)
 {
     string pyclass_name = typestr + string("SamplableSet");
+    declare_checked_iterator<T,Index>(m, pyclass_name + "Iterator");
 
-    py::class_<SamplableSet<T> >(m, pyclass_name.c_str())
+    return py::class_<SamplableSet<T,Index> >(m, pyclass_name.c_str())
 
         .def(py::init<double, double>(), R"pbdoc(
             Default constructor of the class.
@@ -53,53 +959,223 @@ void declare_samplable_set(py::module &m, string typestr)
                max_weight: Maximal weight for elements in the set.
             )pbdoc", py::arg("min_weight"), py::arg("max_weight"))
 
-        .def(py::init<const SamplableSet<T>&>(), R"pbdoc(
+        .def(py::init(&locked_copy<SamplableSet<T,Index> >), R"pbdoc(
             Copy constructor
 
             Args:
                samplable_set: Copied set
             )pbdoc", py::arg("samplable_set"))
 
-        .def("size", &SamplableSet<T>::size, R"pbdoc(
+        .def(py::pickle(&get_state<T,Index>, &set_state<T,Index>))
+
+        .def("save", locked_random(&SamplableSet<T,Index>::save),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Writes a snapshot of the set in a binary file, which can be read
+            back with load.
+
+            Args:
+               path: Path of the snapshot file.
+               with_rng_state: If true, the state of the shared RNG is saved
+                               as well and restored by load.
+            )pbdoc", py::arg("path"), py::arg("with_rng_state") = false)
+
+        .def("start_journal", locked(&SamplableSet<T,Index>::start_journal),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Records the following insertions, weight changes, erasures and
+            clears in a new journal file, which can be applied to another set
+            with replay. Entries are buffered and written by blocks.
+
+            Args:
+               path: Path of the journal file.
+               flush_size: Number of bytes buffered before writing.
+            )pbdoc", py::arg("path"),
+            py::arg("flush_size") = JOURNAL_FLUSH_SIZE)
+
+        .def("flush_journal", locked(&SamplableSet<T,Index>::flush_journal),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Writes the buffered entries of the journal to its file.
+            )pbdoc")
+
+        .def("stop_journal", locked(&SamplableSet<T,Index>::stop_journal),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Flushes and closes the journal.
+            )pbdoc")
+
+        .def("journaling", locked(&SamplableSet<T,Index>::journaling),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns true if the modifications are recorded in a journal.
+            )pbdoc")
+
+        .def("replay", locked(&SamplableSet<T,Index>::replay),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Applies the modifications recorded in a journal file. The tree of
+            group weights is updated once at the end.
+
+            Args:
+               path: Path of the journal file.
+            )pbdoc", py::arg("path"))
+
+        .def("counters", &counters<T,Index>, R"pbdoc(
+            Returns the instrumentation counters of the set as a dict: samples,
+            rejection_trials, group_changes, tree_node_visits and hash_probes.
+            They are always zero unless the module is compiled with
+            SAMPLABLESET_INSTRUMENTATION.
+            )pbdoc")
+
+        .def("reset_counters", locked(&SamplableSet<T,Index>::reset_counters),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Sets the instrumentation counters of the set to zero.
+            )pbdoc")
+
+        .def("memory_usage", &memory_usage<T,Index>, R"pbdoc(
+            Returns the bytes used by the set as a dict: the set object, the
+            buckets and nodes of the hash map of positions, the elements of
+            the groups and their unused capacity, the vectors of groups, the
+            nodes of the tree and the index of its leaves, and the total.
+            Memory owned by the elements (e.g. long strings) is not counted.
+            )pbdoc")
+
+        .def("load_text", [](SamplableSet<T,Index>& samplable_set,
+                const string& path, char delimiter, bool skip_header,
+                unsigned int n_threads)
+            {
+                lock_guard<recursive_mutex> lock(samplable_set.mutex());
+                load_text(samplable_set, path, delimiter, skip_header,
+                        n_threads);
+            }, py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Inserts the elements of a text file, each line holding the fields
+            of an element followed by its weight. The file is read by chunks
+            parsed in parallel. Elements already in the set are left
+            unchanged.
+
+            Args:
+               path: Path of the file.
+               delimiter: Character separating the fields.
+               skip_header: If true, the first line is ignored.
+               n_threads: Number of threads parsing the file, 0 for the
+                          number of cores.
+            )pbdoc", py::arg("path"), py::arg("delimiter") = ',',
+            py::arg("skip_header") = false, py::arg("n_threads") = 0)
+
+        .def_static("load", [](const string& path)
+            {
+                lock_guard<recursive_mutex> rng_lock(
+                        BaseSamplableSet::rng_mutex());
+                return new SamplableSet<T,Index>(
+                        SamplableSet<T,Index>::load(path));
+            },
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Loads a set from a snapshot file written by save. The state of
+            the shared RNG is restored if it was saved.
+
+            Args:
+               path: Path of the snapshot file.
+            )pbdoc", py::arg("path"))
+
+        .def("size", locked(&SamplableSet<T,Index>::size),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Returns the number of elements in the set.
             )pbdoc")
 
-        .def("empty", &SamplableSet<T>::empty, R"pbdoc(
+        .def("empty", locked(&SamplableSet<T,Index>::empty),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Returns true if the set is empty.
             )pbdoc")
 
-        .def("total_weight", &SamplableSet<T>::total_weight, R"pbdoc(
+        .def("total_weight", locked(&SamplableSet<T,Index>::total_weight),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Returns the sum of the weights of the elements in the set.
             )pbdoc")
 
-        .def("count", &SamplableSet<T>::count, R"pbdoc(
+        .def("count", locked(&SamplableSet<T,Index>::count),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Returns the count of a certain element (0 or 1 since it is a set).
 
             Args:
                element: Element of the set.
             )pbdoc", py::arg("element"))
 
-        .def("sample", &SamplableSet<T>::sample, R"pbdoc(
+        .def("sample", locked_random(&SamplableSet<T,Index>::sample),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Returns an element of the set randomly (according to weights) and
             its weight as a tuple.
             )pbdoc")
 
-        .def("get_weight", &SamplableSet<T>::get_weight, R"pbdoc(
+        .def("sample_n", (py::tuple (*)(const SamplableSet<T,Index>&, size_t))
+            &sample_n<T,Index>, R"pbdoc(
+            Returns n elements of the set randomly (according to weights),
+            with replacement, and their weights as a tuple of arrays. Elements
+            are given in an array of shape (n,) or (n, k) for tuples of k int,
+            and in a list for other types.
+
+            Args:
+               n: Number of samples.
+            )pbdoc", py::arg("n"))
+
+        .def("to_arrays", (py::tuple (*)(const SamplableSet<T,Index>&))
+            &to_arrays<T,Index>, R"pbdoc(
+            Returns the elements and the weights of the set as a tuple of
+            contiguous arrays, in the order of iteration. Elements are given in
+            an array of shape (N,) or (N, k) for tuples of k int, and in a
+            list for other types.
+            )pbdoc")
+
+        .def("number_of_groups",
+            locked(&SamplableSet<T,Index>::number_of_groups),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the number of groups of elements with similar weights.
+            )pbdoc")
+
+        .def("group_stats", &group_stats<T,Index>, R"pbdoc(
+            Returns the occupancy of the groups as a dict of arrays indexed by
+            group: the number of elements (size), their total weight (weight),
+            the maximal weight of the group (bound) and the expected
+            acceptance ratio of rejection sampling in the group, mean weight
+            over bound (acceptance, nan for empty groups).
+            )pbdoc")
+
+        .def("group_weights", &group_weights<T,Index>, R"pbdoc(
+            Returns an array of the weights of the elements in a group. The
+            array is a copy, independent of later modifications of the set.
+
+            Args:
+               group_index: Index of the group.
+            )pbdoc", py::arg("group_index"))
+
+        .def("get_weight", locked(&SamplableSet<T,Index>::get_weight),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Returns the weight of an element in the set.
             )pbdoc")
 
-        .def("get_at_iterator", &SamplableSet<T>::get_at_iterator, R"pbdoc(
+        .def("get_at_iterator", locked(&SamplableSet<T,Index>::get_at_iterator),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Returns the element at iterator in the set.
             )pbdoc")
 
-        .def_static("seed", &BaseSamplableSet::seed, R"pbdoc(
+        .def_static("seed", &locked_seed,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Seed the RNG with a new value.
 
             Args:
                seed_value: New value for the seed of the RNG.
             )pbdoc", py::arg("seed_value"))
 
-        .def("insert", &SamplableSet<T>::insert, R"pbdoc(
+        .def_static("get_rng_state", &locked_rng_state,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the state of the RNG shared by the sets as a tuple
+            (state, increment), which can be restored with set_rng_state.
+            )pbdoc")
+
+        .def_static("set_rng_state", &locked_set_rng_state,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Restores a state of the RNG returned by get_rng_state.
+
+            Args:
+               state: Tuple (state, increment) of the RNG.
+            )pbdoc", py::arg("state"))
+
+        .def("insert", locked(&SamplableSet<T,Index>::insert),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Insert an element in the set with its associated weight.
 
             Args:
@@ -107,7 +1183,8 @@ void declare_samplable_set(py::module &m, string typestr)
                weight: Weight for random sampling.
             )pbdoc", py::arg("element"), py::arg("weight") = 0)
 
-        .def("set_weight", &SamplableSet<T>::set_weight, R"pbdoc(
+        .def("set_weight", locked(&SamplableSet<T,Index>::set_weight),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Set weight for an element in the set.
 
             Args:
@@ -115,32 +1192,1820 @@ void declare_samplable_set(py::module &m, string typestr)
                weight: Weight for random sampling.
             )pbdoc", py::arg("element"), py::arg("weight"))
 
-        .def("erase", &SamplableSet<T>::erase, R"pbdoc(
+        .def("erase", locked(&SamplableSet<T,Index>::erase),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Remove an element from the set.
 
             Args:
                element: Element of the set.
             )pbdoc", py::arg("element"))
 
-        .def("clear", &SamplableSet<T>::clear, R"pbdoc(
+        .def("clear", locked(&SamplableSet<T,Index>::clear),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Remove all elements from the container.
             )pbdoc")
 
-        .def("next", &SamplableSet<T>::next, R"pbdoc(
+        .def("next", locked(&SamplableSet<T,Index>::next),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Move the iterator one element ahead.
             )pbdoc")
 
-        .def("init_iterator", &SamplableSet<T>::init_iterator, R"pbdoc(
+        .def("init_iterator", locked(&SamplableSet<T,Index>::init_iterator),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
             Put the iterator at the beginning of the set.
-            )pbdoc");
+            )pbdoc")
+
+        .def("__iter__", [](const SamplableSet<T,Index>& self)
+            {return CheckedIterator<T,Index>(self);},
+            py::keep_alive<0, 1>(), R"pbdoc(
+            Returns an iterator over the pairs of elements and weights. It
+            raises a RuntimeError if elements are inserted or erased during
+            the iteration.
+            )pbdoc")
+
+        .def("gillespie", &gillespie<T,Index>, R"pbdoc(
+            Simulate the elements as reactions firing with rates equal to their
+            weights, using Gillespie's direct method.
+
+            Args:
+               max_events: Maximal number of events to fire.
+               max_time: Time at which the simulation stops.
+               time: Time at the beginning of the simulation.
+               update: Rule applied after each event. If None, the set is left
+                       unchanged. If 'erase', the fired element is removed.
+                       If a dict {fired: [(element, value, mode), ...]}, the
+                       weights are set to value (mode 'set', the default) or
+                       changed by value (mode 'add') in C++. An element is
+                       erased when its weight is not positive. If a callable,
+                       it is called with the fired element; it can modify
+                       this set.
+
+            Returns: A tuple (times, elements, time) with the times of the
+            events, the fired elements and the time at the end of the
+            simulation.
+            )pbdoc", py::arg("max_events"),
+            py::arg("max_time") = numeric_limits<double>::infinity(),
+            py::arg("time") = 0., py::arg("update") = py::none())
+
+        .def("tau_leap", &tau_leap<T,Index>, R"pbdoc(
+            Draw the number of times each element fires during a time tau,
+            the elements firing with rates equal to their weights. The set is
+            left unchanged.
+
+            Args:
+               tau: Duration of the leap.
+
+            Returns: A tuple (elements, counts) of the elements that fired at
+            least once and their number of firings.
+            )pbdoc", py::arg("tau"))
+
+        .def("leap_size", locked(&SamplableSet<T,Index>::leap_size),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns a leap size for which the expected number of firings of
+            each element is at most epsilon.
+
+            Args:
+               epsilon: Maximal expected number of firings per element.
+            )pbdoc", py::arg("epsilon"))
+
+        .def("sample_counts", &sample_counts<T,Index>, R"pbdoc(
+            Draw n elements with replacement according to their weights and
+            count the number of times each element is drawn. The cost scales
+            with the number of distinct elements drawn, not with n.
+
+            Args:
+               n: Number of draws.
+
+            Returns: A tuple (elements, counts) of the elements drawn at least
+            once and their number of draws.
+            )pbdoc", py::arg("n"));
 }
 
-PYBIND11_MODULE(_SamplableSet, m)
+//template function to declare the numpy methods of samplable sets with
+//integer keys
+template<typename T, typename Index>
+void declare_array_methods(py::class_<SamplableSet<T,Index> > pyclass)
 {
-    declare_samplable_set<int>(m, "Int");
-    declare_samplable_set<string>(m, "String");
-    declare_samplable_set<Tuple2Int>(m, "Tuple2Int");
-    declare_samplable_set<Tuple3Int>(m, "Tuple3Int");
-    declare_samplable_set<Tuple2String>(m, "Tuple2String");
-    declare_samplable_set<Tuple3String>(m, "Tuple3String");
+    pyclass
+
+        .def("load_npy", [](SamplableSet<T,Index>& samplable_set,
+                const string& elements_path, const string& weights_path)
+            {
+                lock_guard<recursive_mutex> lock(samplable_set.mutex());
+                load_npy(samplable_set, elements_path, weights_path);
+            }, py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Inserts the elements of a .npy file with the weights of another
+            one, read by chunks. Elements already in the set are left
+            unchanged.
+
+            Args:
+               elements_path: Path of an array of shape (N,) for int
+                              elements, or (N, k) for tuples of k int.
+               weights_path: Path of an array of shape (N,) of weights.
+            )pbdoc", py::arg("elements_path"), py::arg("weights_path"))
+
+        .def("insert_array", &insert_array<T,Index>, R"pbdoc(
+            Insert the elements of an array with their associated weights.
+            Elements already in the set are left unchanged.
+
+            Args:
+               elements: Array of shape (N,) for int elements, or (N, k) for
+                         tuples of k int.
+               weights: Array of shape (N,) of weights for random sampling.
+            )pbdoc", py::arg("elements"), py::arg("weights"))
+
+        .def("set_weight_array", &set_weight_array<T,Index>, R"pbdoc(
+            Set weights for the elements of an array.
+
+            Args:
+               elements: Array of shape (N,) for int elements, or (N, k) for
+                         tuples of k int.
+               weights: Array of shape (N,) of weights for random sampling.
+            )pbdoc", py::arg("elements"), py::arg("weights"))
+
+        .def("execute", &execute<T,Index>, R"pbdoc(
+            Run a buffer of commands in order, in a single call. Each command
+            is a code of the Command enumeration (INSERT, SET_WEIGHT, ERASE,
+            SAMPLE or GET_WEIGHT) applied with an element and a weight. The
+            elements of SAMPLE commands and the weights of commands other than
+            INSERT and SET_WEIGHT are ignored.
+
+            Args:
+               commands: Array of shape (N,) of command codes.
+               elements: Array of shape (N,) for int elements, or (N, k) for
+                         tuples of k int.
+               weights: Array of shape (N,) of weights.
+
+            Returns: A tuple (elements, weights) of arrays. For SAMPLE commands,
+            they hold the sampled element and its weight. For other commands,
+            the weight is the one of the element before the command, or NaN if
+            it was not in the set. If a command fails (e.g. sampling an empty
+            set), an error is raised and the previous commands are kept.
+            )pbdoc", py::arg("commands"), py::arg("elements"),
+            py::arg("weights"))
+
+        .def("group_keys", &group_keys<T,Index>, R"pbdoc(
+            Returns an array of the elements in a group, of shape (N,) for
+            int elements, or (N, k) for tuples of k int. The array is a copy,
+            independent of later modifications of the set.
+
+            Args:
+               group_index: Index of the group.
+            )pbdoc", py::arg("group_index"));
+}
+
+//template function to declare different types of next reaction set
+template<typename T>
+void declare_next_reaction_set(py::module &m, string typestr)
+{
+    string pyclass_name = typestr + string("NextReactionSet");
+
+    py::class_<NextReactionSet<T> >(m, pyclass_name.c_str())
+
+        .def(py::init<double, double, double>(), R"pbdoc(
+            Default constructor of the class.
+
+            Args:
+               min_weight: Minimal weight for elements in the set.
+               max_weight: Maximal weight for elements in the set.
+               time: Time at the beginning of the simulation.
+            )pbdoc", py::arg("min_weight"), py::arg("max_weight"),
+            py::arg("time") = 0.)
+
+        .def(py::init(&locked_copy<NextReactionSet<T> >), R"pbdoc(
+            Copy constructor
+
+            Args:
+               next_reaction_set: Copied set
+            )pbdoc", py::arg("next_reaction_set"))
+
+        .def("size", locked(&NextReactionSet<T>::size),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the number of elements in the set.
+            )pbdoc")
+
+        .def("empty", locked(&NextReactionSet<T>::empty),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns true if the set is empty.
+            )pbdoc")
+
+        .def("total_weight", locked(&NextReactionSet<T>::total_weight),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the sum of the weights of the elements in the set.
+            )pbdoc")
+
+        .def("count", locked(&NextReactionSet<T>::count),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the count of a certain element (0 or 1 since it is a set).
+
+            Args:
+               element: Element of the set.
+            )pbdoc", py::arg("element"))
+
+        .def("time", locked(&NextReactionSet<T>::time),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the current time.
+            )pbdoc")
+
+        .def("next_time", locked(&NextReactionSet<T>::next_time),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the putative time of the next reaction.
+            )pbdoc")
+
+        .def("sample", locked_random(&NextReactionSet<T>::sample),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Fires the next reaction and returns its element and weight as a
+            tuple. The time is advanced to the time of the reaction.
+            )pbdoc")
+
+        .def("get_weight", locked(&NextReactionSet<T>::get_weight),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the weight of an element in the set.
+            )pbdoc")
+
+        .def("insert", locked_random(&NextReactionSet<T>::insert),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Insert an element in the set with its associated weight.
+
+            Args:
+               element: Element of the set.
+               weight: Weight for random sampling.
+            )pbdoc", py::arg("element"), py::arg("weight") = 0)
+
+        .def("set_weight", locked_random(&NextReactionSet<T>::set_weight),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Set weight for an element in the set. Its putative time is
+            rescaled.
+
+            Args:
+               element: Element of the set.
+               weight: Weight for random sampling.
+            )pbdoc", py::arg("element"), py::arg("weight"))
+
+        .def("erase", locked(&NextReactionSet<T>::erase),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Remove an element from the set.
+
+            Args:
+               element: Element of the set.
+            )pbdoc", py::arg("element"))
+
+        .def("clear", locked(&NextReactionSet<T>::clear),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Remove all elements from the container.
+            )pbdoc")
+
+        .def("gillespie", &next_reaction<T>, R"pbdoc(
+            Simulate the elements as reactions firing with rates equal to their
+            weights, using the next reaction method.
+
+            Args:
+               max_events: Maximal number of events to fire.
+               max_time: Time at which the simulation stops.
+               update: Rule applied after each event. If None, the set is left
+                       unchanged. If 'erase', the fired element is removed.
+                       If a dict {fired: [(element, value, mode), ...]}, the
+                       weights are set to value (mode 'set', the default) or
+                       changed by value (mode 'add') in C++. An element is
+                       erased when its weight is not positive. If a callable,
+                       it is called with the fired element; it can modify
+                       this set.
+
+            Returns: A tuple (times, elements, time) with the times of the
+            events, the fired elements and the time at the end of the
+            simulation.
+            )pbdoc", py::arg("max_events"),
+            py::arg("max_time") = numeric_limits<double>::infinity(),
+            py::arg("update") = py::none());
+}
+
+//template function to declare different types of nested samplable set
+template<typename S, typename T>
+void declare_nested_samplable_set(py::module &m, string typestr)
+{
+    string pyclass_name = typestr + string("NestedSamplableSet");
+
+    py::class_<NestedSamplableSet<S,T> >(m, pyclass_name.c_str())
+
+        .def(py::init<double, double, double>(), R"pbdoc(
+            Default constructor of the class.
+
+            Args:
+               min_weight: Minimal weight for elements in the set.
+               max_weight: Maximal weight for elements in the set.
+               max_total_weight: Maximal total weight of a subset.
+            )pbdoc", py::arg("min_weight"), py::arg("max_weight"),
+            py::arg("max_total_weight"))
+
+        .def("size", locked(&NestedSamplableSet<S,T>::size),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the number of elements in all subsets.
+            )pbdoc")
+
+        .def("empty", locked(&NestedSamplableSet<S,T>::empty),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns true if the set is empty.
+            )pbdoc")
+
+        .def("number_of_subsets",
+            locked(&NestedSamplableSet<S,T>::number_of_subsets),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the number of non-empty subsets.
+            )pbdoc")
+
+        .def("total_weight", locked(&NestedSamplableSet<S,T>::total_weight),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the sum of the weights of the elements in the set.
+            )pbdoc")
+
+        .def("count", [](const NestedSamplableSet<S,T>& self, const S& subset)
+            {
+                lock_guard<recursive_mutex> lock(self.mutex());
+                return self.count(subset);
+            }, py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the count of a subset (0 or 1).
+
+            Args:
+               subset: Subset of the set.
+            )pbdoc", py::arg("subset"))
+
+        .def("count", [](const NestedSamplableSet<S,T>& self, const S& subset,
+                const T& element)
+            {
+                lock_guard<recursive_mutex> lock(self.mutex());
+                return self.count(subset, element);
+            }, py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the count of an element in a subset (0 or 1).
+
+            Args:
+               subset: Subset of the set.
+               element: Element of the subset.
+            )pbdoc", py::arg("subset"), py::arg("element"))
+
+        .def("sample", locked_random(&NestedSamplableSet<S,T>::sample),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns a subset randomly (according to total weights), then an
+            element of this subset randomly (according to weights), as a tuple
+            ((subset, element), weight).
+            )pbdoc")
+
+        .def("get_weight", [](const NestedSamplableSet<S,T>& self,
+                const S& subset)
+            {
+                lock_guard<recursive_mutex> lock(self.mutex());
+                return self.get_weight(subset);
+            }, py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the total weight of a subset.
+
+            Args:
+               subset: Subset of the set.
+            )pbdoc", py::arg("subset"))
+
+        .def("get_weight", [](const NestedSamplableSet<S,T>& self,
+                const S& subset, const T& element)
+            {
+                lock_guard<recursive_mutex> lock(self.mutex());
+                return self.get_weight(subset, element);
+            }, py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the weight of an element in a subset.
+
+            Args:
+               subset: Subset of the set.
+               element: Element of the subset.
+            )pbdoc", py::arg("subset"), py::arg("element"))
+
+        .def("insert", locked(&NestedSamplableSet<S,T>::insert),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Insert an element in a subset with its associated weight.
+
+            Args:
+               subset: Subset of the set.
+               element: Element of the subset.
+               weight: Weight for random sampling.
+            )pbdoc", py::arg("subset"), py::arg("element"),
+            py::arg("weight") = 0)
+
+        .def("set_weight", locked(&NestedSamplableSet<S,T>::set_weight),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Set weight for an element in a subset.
+
+            Args:
+               subset: Subset of the set.
+               element: Element of the subset.
+               weight: Weight for random sampling.
+            )pbdoc", py::arg("subset"), py::arg("element"), py::arg("weight"))
+
+        .def("erase", [](NestedSamplableSet<S,T>& self, const S& subset)
+            {
+                lock_guard<recursive_mutex> lock(self.mutex());
+                self.erase(subset);
+            }, py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Remove a subset and all its elements.
+
+            Args:
+               subset: Subset of the set.
+            )pbdoc", py::arg("subset"))
+
+        .def("erase", [](NestedSamplableSet<S,T>& self, const S& subset,
+                const T& element)
+            {
+                lock_guard<recursive_mutex> lock(self.mutex());
+                self.erase(subset, element);
+            }, py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Remove an element from a subset.
+
+            Args:
+               subset: Subset of the set.
+               element: Element of the subset.
+            )pbdoc", py::arg("subset"), py::arg("element"))
+
+        .def("clear", locked(&NestedSamplableSet<S,T>::clear),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Remove all subsets and elements from the container.
+            )pbdoc");
+}
+
+//function to declare the samplable set of python objects. The GIL is held
+//during the calls since the keys are hashed and compared by python, and the
+//set is locked as the other sets.
+void declare_pyobject_samplable_set(py::module &m)
+{
+    declare_checked_iterator<PyKey,InGroupIndex>(m,
+            "PyObjectSamplableSetIterator");
+    py::class_<SamplableSet<PyKey> >(m, "PyObjectSamplableSet")
+
+        .def(py::init<double, double>(), R"pbdoc(
+            Default constructor of the class.
+
+            Args:
+               min_weight: Minimal weight for elements in the set.
+               max_weight: Maximal weight for elements in the set.
+            )pbdoc", py::arg("min_weight"), py::arg("max_weight"))
+
+        .def(py::init([](const SamplableSet<PyKey>& samplable_set)
+            {
+                unique_lock<recursive_mutex> lock = lock_set(samplable_set);
+                return new SamplableSet<PyKey>(samplable_set);
+            }), R"pbdoc(
+            Copy constructor
+
+            Args:
+               samplable_set: Copied set
+            )pbdoc", py::arg("samplable_set"))
+
+        .def("size", locked_with_gil(&SamplableSet<PyKey>::size), R"pbdoc(
+            Returns the number of elements in the set.
+            )pbdoc")
+
+        .def("empty", locked_with_gil(&SamplableSet<PyKey>::empty), R"pbdoc(
+            Returns true if the set is empty.
+            )pbdoc")
+
+        .def("total_weight",
+            locked_with_gil(&SamplableSet<PyKey>::total_weight), R"pbdoc(
+            Returns the sum of the weights of the elements.
+            )pbdoc")
+
+        .def("number_of_groups", &SamplableSet<PyKey>::number_of_groups,
+            R"pbdoc(
+            Returns the number of groups of elements.
+            )pbdoc")
+
+        .def("counters", &counters<PyKey,InGroupIndex>, R"pbdoc(
+            Returns the instrumentation counters of the set as a dict.
+            )pbdoc")
+
+        .def("reset_counters",
+            locked_with_gil(&SamplableSet<PyKey>::reset_counters), R"pbdoc(
+            Sets the instrumentation counters of the set to zero.
+            )pbdoc")
+
+        .def("group_stats", &group_stats<PyKey,InGroupIndex>, R"pbdoc(
+            Returns the occupancy of the groups as a dict of arrays: size,
+            weight, bound and acceptance.
+            )pbdoc")
+
+        .def("memory_usage", &memory_usage<PyKey,InGroupIndex>, R"pbdoc(
+            Returns the bytes used by the set as a dict. The python objects
+            referenced by the set are not counted.
+            )pbdoc")
+
+        .def("count", locked_with_gil(&SamplableSet<PyKey>::count), R"pbdoc(
+            Returns 1 if the element is in the set, 0 otherwise.
+
+            Args:
+               element: Element to check.
+            )pbdoc", py::arg("element"))
+
+        .def("sample", [](const SamplableSet<PyKey>& self)
+            {
+                unique_lock<recursive_mutex> lock = lock_set(self);
+                unique_lock<recursive_mutex> rng_lock = lock_rng();
+                return self.sample();
+            }, R"pbdoc(
+            Returns an element and its weight, according to the weight
+            distribution.
+            )pbdoc")
+
+        .def("sample_n", (py::tuple (*)(const SamplableSet<PyKey>&, size_t))
+            &sample_n, R"pbdoc(
+            Returns n elements in a list and their weights in an array,
+            sampled with replacement.
+
+            Args:
+               n: Number of samples.
+            )pbdoc", py::arg("n"))
+
+        .def("sample_counts", (py::tuple (*)(const SamplableSet<PyKey>&,
+                unsigned long)) &sample_counts, R"pbdoc(
+            Returns the elements drawn at least once in n draws with
+            replacement, in a list, and their counts in an array.
+
+            Args:
+               n: Number of draws.
+            )pbdoc", py::arg("n"))
+
+        .def("get_weight", locked_with_gil(&SamplableSet<PyKey>::get_weight),
+            R"pbdoc(
+            Returns the weight of an element in the set.
+            )pbdoc", py::arg("element"))
+
+        .def("insert", locked_with_gil(&SamplableSet<PyKey>::insert), R"pbdoc(
+            Insert an element in the set with its associated weight.
+
+            Args:
+               element: Element of the set.
+               weight: Weight for random sampling.
+            )pbdoc", py::arg("element"), py::arg("weight") = 0)
+
+        .def("set_weight", locked_with_gil(&SamplableSet<PyKey>::set_weight),
+            R"pbdoc(
+            Set weight for an element in the set.
+
+            Args:
+               element: Element of the set.
+               weight: Weight for random sampling.
+            )pbdoc", py::arg("element"), py::arg("weight"))
+
+        .def("erase", locked_with_gil(&SamplableSet<PyKey>::erase), R"pbdoc(
+            Remove an element from the set.
+
+            Args:
+               element: Element of the set.
+            )pbdoc", py::arg("element"))
+
+        .def("clear", locked_with_gil(&SamplableSet<PyKey>::clear), R"pbdoc(
+            Remove all elements from the container.
+            )pbdoc")
+
+        .def("__iter__", [](const SamplableSet<PyKey>& self)
+            {return CheckedIterator<PyKey,InGroupIndex>(self);},
+            py::keep_alive<0, 1>(), R"pbdoc(
+            Returns an iterator over the pairs of elements and weights. It
+            raises a RuntimeError if elements are inserted or erased during
+            the iteration.
+            )pbdoc")
+
+        .def(py::pickle(
+            [](const SamplableSet<PyKey>& self)
+            {
+                unique_lock<recursive_mutex> lock = lock_set(self);
+                py::list elements_weights;
+                for (const auto& element_weight_pair : self)
+                {
+                    elements_weights.append(py::cast(element_weight_pair));
+                }
+                return py::make_tuple(self.min_weight(), self.max_weight(),
+                        elements_weights);
+            },
+            [](py::tuple state)
+            {
+                SamplableSet<PyKey>* set = new SamplableSet<PyKey>(
+                        state[0].cast<double>(), state[1].cast<double>());
+                py::list elements_weights = state[2];
+                for (py::handle item : elements_weights)
+                {
+                    pair<PyKey,double> element_weight_pair =
+                        item.cast<pair<PyKey,double> >();
+                    set->insert(element_weight_pair.first,
+                            element_weight_pair.second);
+                }
+                return set;
+            }));
+}
+
+//Type-erased samplable set used by the python SamplableSet class. The
+//elements are converted from python objects once per call.
+class AnySamplableSet
+{
+public:
+    virtual ~AnySamplableSet() {}
+    virtual py::object cpp_set() const = 0;
+    virtual AnySamplableSet* copy() const = 0;
+    virtual size_t size() const = 0;
+    virtual double total_weight() const = 0;
+    virtual size_t count(py::handle element) const = 0;
+    virtual double get_weight(py::handle element) const = 0;
+    virtual void insert(py::handle element, double weight) = 0;
+    virtual void set_weight(py::handle element, double weight) = 0;
+    virtual void erase(py::handle element) = 0;
+    virtual void clear() = 0;
+    virtual py::tuple sample(bool replace) = 0;
+    virtual py::tuple sample_n(size_t n) const = 0;
+    virtual py::tuple sample_counts(unsigned long n) const = 0;
+    virtual py::object iter() const = 0;
+};
+
+//Lock of a set during a call from the python SamplableSet class: the GIL
+//is released and the set locked. Sets of python objects are locked with the
+//GIL released, and keep the GIL during the call to compare the keys.
+template<typename T, typename Index>
+class SetGuard
+{
+public:
+    SetGuard(const SamplableSet<T,Index>& set) :
+        release_(), lock_(set.mutex()) {}
+private:
+    py::gil_scoped_release release_;
+    lock_guard<recursive_mutex> lock_;
+};
+
+template<typename Index>
+class SetGuard<PyKey,Index>
+{
+public:
+    SetGuard(const SamplableSet<PyKey,Index>& set) : lock_(lock_set(set)) {}
+private:
+    unique_lock<recursive_mutex> lock_;
+};
+
+//Lock of a set and of the shared RNG
+template<typename T, typename Index>
+class RandomGuard
+{
+public:
+    RandomGuard(const SamplableSet<T,Index>& set) :
+        release_(), lock_(set.mutex()),
+        rng_lock_(BaseSamplableSet::rng_mutex()) {}
+private:
+    py::gil_scoped_release release_;
+    lock_guard<recursive_mutex> lock_;
+    lock_guard<recursive_mutex> rng_lock_;
+};
+
+template<typename Index>
+class RandomGuard<PyKey,Index>
+{
+public:
+    RandomGuard(const SamplableSet<PyKey,Index>& set) :
+        lock_(lock_set(set)), rng_lock_(lock_rng()) {}
+private:
+    unique_lock<recursive_mutex> lock_;
+    unique_lock<recursive_mutex> rng_lock_;
+};
+
+//Samplable set of elements of type T, held by its python object
+template<typename T, typename Index = InGroupIndex>
+class TypedSamplableSet : public AnySamplableSet
+{
+public:
+    TypedSamplableSet(double min_weight, double max_weight) :
+        cpp_set_(py::cast(new SamplableSet<T,Index>(min_weight, max_weight),
+                    py::return_value_policy::take_ownership)),
+        set_(cpp_set_.cast<SamplableSet<T,Index>*>()) {}
+    TypedSamplableSet(py::object cpp_set) :
+        cpp_set_(cpp_set),
+        set_(cpp_set_.cast<SamplableSet<T,Index>*>()) {}
+
+    py::object cpp_set() const {return cpp_set_;}
+
+    AnySamplableSet* copy() const
+    {
+        return new TypedSamplableSet<T,Index>(
+                cpp_set_.attr("__class__")(cpp_set_));
+    }
+
+    size_t size() const
+    {
+        SetGuard<T,Index> guard(*set_);
+        return set_->size();
+    }
+
+    double total_weight() const
+    {
+        SetGuard<T,Index> guard(*set_);
+        return set_->total_weight();
+    }
+
+    size_t count(py::handle element) const
+    {
+        T key = to_key(element);
+        SetGuard<T,Index> guard(*set_);
+        return set_->count(key);
+    }
+
+    double get_weight(py::handle element) const
+    {
+        T key = to_key(element);
+        SetGuard<T,Index> guard(*set_);
+        return set_->get_weight(key);
+    }
+
+    void insert(py::handle element, double weight)
+    {
+        T key = to_key(element);
+        SetGuard<T,Index> guard(*set_);
+        set_->insert(key, weight);
+    }
+
+    void set_weight(py::handle element, double weight)
+    {
+        T key = to_key(element);
+        SetGuard<T,Index> guard(*set_);
+        set_->set_weight(key, weight);
+    }
+
+    void erase(py::handle element)
+    {
+        T key = to_key(element);
+        SetGuard<T,Index> guard(*set_);
+        set_->erase(key);
+    }
+
+    void clear()
+    {
+        SetGuard<T,Index> guard(*set_);
+        set_->clear();
+    }
+
+    py::tuple sample(bool replace)
+    {
+        pair<T,double> element_weight_pair;
+        {
+            RandomGuard<T,Index> guard(*set_);
+            element_weight_pair = set_->sample();
+            if (not replace)
+            {
+                set_->erase(element_weight_pair.first);
+            }
+        }
+        return py::cast(element_weight_pair);
+    }
+
+    py::tuple sample_n(size_t n) const {return ::sample_n(*set_, n);}
+
+    py::tuple sample_counts(unsigned long n) const
+        {return ::sample_counts(*set_, n);}
+
+    py::object iter() const
+        {return py::cast(CheckedIterator<T,Index>(*set_));}
+
+private:
+    py::object cpp_set_;
+    SamplableSet<T,Index>* set_;
+
+    static T to_key(py::handle element)
+    {
+        try
+        {
+            return element.cast<T>();
+        }
+        catch (const py::cast_error&)
+        {
+            throw py::type_error("Incompatible element "
+                    + string(py::repr(element)));
+        }
+    }
+};
+
+//create a typed samplable set from the name of its type
+AnySamplableSet* make_typed_set(const string& cpp_type, double min_weight,
+        double max_weight)
+{
+    if (cpp_type == "int" or cpp_type == "Int")
+    {
+        return new TypedSamplableSet<int>(min_weight, max_weight);
+    }
+    if (cpp_type == "int64" or cpp_type == "Int64")
+    {
+        return new TypedSamplableSet<int64_t, LargeInGroupIndex>(min_weight,
+                max_weight);
+    }
+    if (cpp_type == "uint64" or cpp_type == "UInt64")
+    {
+        return new TypedSamplableSet<uint64_t, LargeInGroupIndex>(min_weight,
+                max_weight);
+    }
+    if (cpp_type == "str" or cpp_type == "String")
+    {
+        return new TypedSamplableSet<string>(min_weight, max_weight);
+    }
+    if (cpp_type == "2int" or cpp_type == "Tuple2Int")
+    {
+        return new TypedSamplableSet<Tuple2Int>(min_weight, max_weight);
+    }
+    if (cpp_type == "3int" or cpp_type == "Tuple3Int")
+    {
+        return new TypedSamplableSet<Tuple3Int>(min_weight, max_weight);
+    }
+    if (cpp_type == "2str" or cpp_type == "Tuple2String")
+    {
+        return new TypedSamplableSet<Tuple2String>(min_weight, max_weight);
+    }
+    if (cpp_type == "3str" or cpp_type == "Tuple3String")
+    {
+        return new TypedSamplableSet<Tuple3String>(min_weight, max_weight);
+    }
+    if (cpp_type == "object" or cpp_type == "PyObject")
+    {
+        return new TypedSamplableSet<PyKey>(min_weight, max_weight);
+    }
+    throw py::value_error("Unknown cpp_type " + cpp_type);
+}
+
+//wrap a typed samplable set given by its python object
+AnySamplableSet* wrap_typed_set(const string& cpp_type, py::object cpp_set)
+{
+    if (cpp_type == "int" or cpp_type == "Int")
+    {
+        return new TypedSamplableSet<int>(cpp_set);
+    }
+    if (cpp_type == "int64" or cpp_type == "Int64")
+    {
+        return new TypedSamplableSet<int64_t, LargeInGroupIndex>(cpp_set);
+    }
+    if (cpp_type == "uint64" or cpp_type == "UInt64")
+    {
+        return new TypedSamplableSet<uint64_t, LargeInGroupIndex>(cpp_set);
+    }
+    if (cpp_type == "str" or cpp_type == "String")
+    {
+        return new TypedSamplableSet<string>(cpp_set);
+    }
+    if (cpp_type == "2int" or cpp_type == "Tuple2Int")
+    {
+        return new TypedSamplableSet<Tuple2Int>(cpp_set);
+    }
+    if (cpp_type == "3int" or cpp_type == "Tuple3Int")
+    {
+        return new TypedSamplableSet<Tuple3Int>(cpp_set);
+    }
+    if (cpp_type == "2str" or cpp_type == "Tuple2String")
+    {
+        return new TypedSamplableSet<Tuple2String>(cpp_set);
+    }
+    if (cpp_type == "3str" or cpp_type == "Tuple3String")
+    {
+        return new TypedSamplableSet<Tuple3String>(cpp_set);
+    }
+    if (cpp_type == "object" or cpp_type == "PyObject")
+    {
+        return new TypedSamplableSet<PyKey>(cpp_set);
+    }
+    throw py::value_error("Unknown cpp_type " + cpp_type);
+}
+
+//infer the type of the set from its first element, other hashable elements
+//than int, str and their tuples are kept as python objects
+string infer_type(py::handle element)
+{
+    if (py::isinstance<py::int_>(element))
+    {
+        return "int";
+    }
+    if (py::isinstance<py::str>(element))
+    {
+        return "str";
+    }
+    if (py::isinstance<py::tuple>(element))
+    {
+        py::tuple tuple = py::reinterpret_borrow<py::tuple>(element);
+        if (tuple.size() == 2 or tuple.size() == 3)
+        {
+            string size = to_string(tuple.size());
+            py::object first = tuple[0];
+            if (py::isinstance<py::int_>(first))
+            {
+                return size + "int";
+            }
+            if (py::isinstance<py::str>(first))
+            {
+                return size + "str";
+            }
+        }
+    }
+    if (PyObject_Hash(element.ptr()) == -1)
+    {
+        PyErr_Clear();
+        throw py::value_error("Cannot infer the type from the element");
+    }
+    return "object";
+}
+
+//names of the methods of the C++ sets forwarded by the python class
+const vector<string> CPP_METHODS = {"size", "total_weight", "count",
+    "insert", "next", "init_iterator", "set_weight", "get_weight", "empty",
+    "get_at_iterator", "erase", "clear", "gillespie", "tau_leap", "leap_size",
+    "to_arrays", "number_of_groups", "group_stats", "group_weights",
+    "group_keys", "execute", "save", "load_text", "load_npy", "start_journal",
+    "flush_journal", "stop_journal", "journaling", "replay", "counters",
+    "reset_counters", "memory_usage"};
+
+//Python SamplableSet class. The type of the elements is chosen once, when
+//it is given or inferred, and each operation is then a single C++ call.
+class PySamplableSet
+{
+public:
+    PySamplableSet(double min_weight, double max_weight, py::object cpp_type) :
+        min_weight_(min_weight),
+        max_weight_(max_weight),
+        cpp_type_(cpp_type),
+        set_()
+    {
+        if (min_weight <= 0 or max_weight == numeric_limits<double>::infinity()
+                or max_weight < min_weight)
+        {
+            throw py::value_error("Invalid min_weight or max_weight");
+        }
+        if (not cpp_type_.is_none())
+        {
+            set_.reset(make_typed_set(cpp_type_.cast<string>(), min_weight_,
+                        max_weight_));
+        }
+    }
+
+    double min_weight() const {return min_weight_;}
+    double max_weight() const {return max_weight_;}
+    py::object cpp_type() const {return cpp_type_;}
+    bool specified() const {return bool(set_);}
+
+    //set accessed by the methods, which are undefined without a type
+    AnySamplableSet& typed() const
+    {
+        if (not set_)
+        {
+            throw runtime_error("The method is undefined until the "
+                    "underlying type is known");
+        }
+        return *set_;
+    }
+
+    //set the type of the elements if it is not known yet
+    void specify(const string& cpp_type)
+    {
+        if (not set_)
+        {
+            cpp_type_ = py::str(cpp_type);
+            set_.reset(make_typed_set(cpp_type, min_weight_, max_weight_));
+        }
+    }
+
+    //wrap an existing C++ set
+    void specify(py::object cpp_type, py::object cpp_set)
+    {
+        cpp_type_ = cpp_type;
+        set_.reset(wrap_typed_set(cpp_type.cast<string>(), cpp_set));
+    }
+
+    void set_item(py::handle element, double weight)
+    {
+        if (not set_)
+        {
+            specify(infer_type(element));
+        }
+        set_->set_weight(element, weight);
+    }
+
+    double get_item(py::handle element) const
+    {
+        try
+        {
+            return typed().get_weight(element);
+        }
+        catch (const out_of_range& error)
+        {
+            throw py::key_error(error.what());
+        }
+    }
+
+    py::tuple sample(bool replace)
+    {
+        try
+        {
+            return typed().sample(replace);
+        }
+        catch (const out_of_range& error)
+        {
+            throw py::key_error(error.what());
+        }
+    }
+
+    //call a method of the C++ set, the end of iteration being signaled with
+    //an IndexError
+    void iterator_call(const char* name)
+    {
+        try
+        {
+            typed().cpp_set().attr(name)();
+        }
+        catch (py::error_already_set& error)
+        {
+            if (error.matches(PyExc_IndexError))
+            {
+                throw py::stop_iteration();
+            }
+            throw;
+        }
+    }
+
+    //set the type from the shape of an array if it is not known yet
+    void array_checkup(py::handle elements)
+    {
+        if (not set_)
+        {
+            py::object dtype = py::getattr(elements, "dtype", py::none());
+            if (not dtype.is_none() and
+                    string("iu").find(dtype.attr("kind").cast<string>())
+                    == string::npos)
+            {
+                throw py::type_error("The keys must be an array of integers");
+            }
+            py::tuple shape = py::getattr(elements, "shape", py::tuple());
+            if (shape.size() == 1)
+            {
+                specify("int");
+            }
+            else if (shape.size() == 2 and (shape[1].cast<size_t>() == 2 or
+                        shape[1].cast<size_t>() == 3))
+            {
+                specify(to_string(shape[1].cast<size_t>()) + "int");
+            }
+            else
+            {
+                throw py::value_error("Cannot infer the type from the array");
+            }
+        }
+        if (not py::hasattr(set_->cpp_set(), "insert_array"))
+        {
+            throw py::type_error("Arrays are not supported for cpp_type "
+                    + cpp_type_.cast<string>());
+        }
+    }
+
+    //attributes of the C++ set that are not defined by the class
+    py::object get_attr(const string& name) const
+    {
+        bool forwarded = (not name.empty() and name[0] != '_');
+        if (not set_)
+        {
+            forwarded = (find(CPP_METHODS.begin(), CPP_METHODS.end(), name) !=
+                    CPP_METHODS.end());
+        }
+        if (not forwarded)
+        {
+            PyErr_SetString(PyExc_AttributeError, name.c_str());
+            throw py::error_already_set();
+        }
+        if (not set_)
+        {
+            return py::cpp_function([](py::args, py::kwargs)
+                {
+                    throw runtime_error("The method is undefined until the "
+                            "underlying type is known");
+                });
+        }
+        return set_->cpp_set().attr(name.c_str());
+    }
+
+    PySamplableSet* copy() const
+    {
+        PySamplableSet* set_copy = new PySamplableSet(min_weight_, max_weight_,
+                py::none());
+        set_copy->cpp_type_ = cpp_type_;
+        if (set_)
+        {
+            set_copy->set_.reset(set_->copy());
+        }
+        return set_copy;
+    }
+
+private:
+    double min_weight_;
+    double max_weight_;
+    py::object cpp_type_;
+    unique_ptr<AnySamplableSet> set_;
+};
+
+//Generator of samples from a python SamplableSet
+class SampleIterator
+{
+public:
+    SampleIterator(py::object set, size_t n_samples, bool replace) :
+        set_(set), n_samples_(n_samples), replace_(replace) {}
+
+    py::tuple next()
+    {
+        if (n_samples_ == 0)
+        {
+            throw py::stop_iteration();
+        }
+        n_samples_--;
+        return set_.cast<PySamplableSet&>().sample(replace_);
+    }
+
+private:
+    py::object set_;
+    size_t n_samples_;
+    bool replace_;
+};
+
+//create a python SamplableSet, filled from a dict or an iterable of pairs
+PySamplableSet* new_python_samplable_set(double min_weight, double max_weight,
+        py::object elements_weights, py::object cpp_type)
+{
+    PySamplableSet* set = new PySamplableSet(min_weight, max_weight, cpp_type);
+    try
+    {
+        if (py::isinstance<py::dict>(elements_weights))
+        {
+            elements_weights = elements_weights.attr("items")();
+        }
+        if (not elements_weights.is_none())
+        {
+            for (py::handle item : elements_weights)
+            {
+                py::tuple pair(py::reinterpret_borrow<py::object>(item));
+                if (pair.size() != 2)
+                {
+                    throw py::value_error(
+                            "Expected pairs of elements and weights");
+                }
+                py::object element = pair[0];
+                set->set_item(element, pair[1].cast<double>());
+            }
+        }
+    }
+    catch (...)
+    {
+        delete set;
+        throw;
+    }
+    return set;
+}
+
+//type of the C++ set matching the signature of the elements of a snapshot
+string snapshot_cpp_type(const string& signature)
+{
+    const vector<pair<string, string> > cpp_types = {{"i4", "int"},
+        {"i8", "int64"}, {"u8", "uint64"}, {"s", "str"}, {"(i4,i4)", "2int"},
+        {"(i4,i4,i4)", "3int"}, {"(s,s)", "2str"}, {"(s,s,s)", "3str"}};
+    for (const auto& signature_type_pair : cpp_types)
+    {
+        if (signature_type_pair.first == signature)
+        {
+            return signature_type_pair.second;
+        }
+    }
+    throw py::value_error("No set for elements of type " + signature);
+}
+
+//load a python SamplableSet from a snapshot file
+PySamplableSet* load_python_samplable_set(const string& path)
+{
+    SnapshotHeader header;
+    {
+        ifstream file(path, ios::binary);
+        if (not file)
+        {
+            throw runtime_error("Cannot open " + path + " for reading");
+        }
+        header = read_snapshot_header(file);
+    }
+    py::str cpp_type(snapshot_cpp_type(header.signature));
+    unique_ptr<PySamplableSet> set(new PySamplableSet(header.min_weight,
+                header.max_weight, cpp_type));
+    set->specify(cpp_type, set->typed().cpp_set().attr("load")(path));
+    return set.release();
+}
+
+//draw n elements with replacement from a mapped or shared set, which is
+//not locked by the caller
+template<typename T, typename Set>
+py::tuple sample_n_unlocked(const Set& samplable_set, size_t n)
+{
+    unique_lock<recursive_mutex> rng_lock = lock_rng();
+    py::array_t<typename NumpyKey<T>::Scalar> keys = new_key_array<T>(n);
+    py::array_t<double> weights(n);
+    typename NumpyKey<T>::Scalar* key_ptr = keys.mutable_data();
+    double* weight_ptr = weights.mutable_data();
+    {
+        py::gil_scoped_release release;
+        for (size_t i = 0; i < n; i++)
+        {
+            pair<T,double> element_weight_pair = samplable_set.sample();
+            NumpyKey<T>::write(element_weight_pair.first,
+                    key_ptr + i*NumpyKey<T>::width);
+            weight_ptr[i] = element_weight_pair.second;
+        }
+    }
+    return py::make_tuple(keys, weights);
+}
+
+//template function to declare read-only sets mapped from snapshots
+//mapped sets are never modified, only the RNG is locked
+template<typename T>
+void declare_mapped_samplable_set(py::module &m, string typestr)
+{
+    string pyclass_name = typestr + string("MappedSamplableSet");
+
+    py::class_<MappedSamplableSet<T> >(m, pyclass_name.c_str())
+
+        .def(py::init<const string&, bool>(),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Maps a snapshot file written by save, without copying it.
+
+            Args:
+               path: Path of the snapshot file.
+               validate: If True, the weight of every element is checked,
+                         which reads the whole file.
+            )pbdoc", py::arg("path"), py::arg("validate") = false)
+
+        .def("size", &MappedSamplableSet<T>::size, R"pbdoc(
+            Returns the number of elements in the set.
+            )pbdoc")
+
+        .def("__len__", &MappedSamplableSet<T>::size)
+
+        .def("empty", &MappedSamplableSet<T>::empty, R"pbdoc(
+            Returns true if the set is empty.
+            )pbdoc")
+
+        .def("total_weight", &MappedSamplableSet<T>::total_weight, R"pbdoc(
+            Returns the sum of the weights of the elements in the set.
+            )pbdoc")
+
+        .def_property_readonly("min_weight",
+            &MappedSamplableSet<T>::min_weight)
+
+        .def_property_readonly("max_weight",
+            &MappedSamplableSet<T>::max_weight)
+
+        .def("number_of_groups", &MappedSamplableSet<T>::number_of_groups,
+            R"pbdoc(
+            Returns the number of groups of elements with similar weights.
+            )pbdoc")
+
+        .def("sample", [](const MappedSamplableSet<T>& mapped_set)
+            {
+                lock_guard<recursive_mutex> rng_lock(
+                        BaseSamplableSet::rng_mutex());
+                return mapped_set.sample();
+            }, py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns an element of the set randomly (according to weights) and
+            its weight as a tuple.
+            )pbdoc")
+
+        .def("sample_n", &sample_n_unlocked<T, MappedSamplableSet<T> >,
+            R"pbdoc(
+            Returns n elements of the set randomly (according to weights),
+            with replacement, and their weights as a tuple of arrays.
+
+            Args:
+               n: Number of samples.
+            )pbdoc", py::arg("n"))
+
+        .def_static("seed", &locked_seed,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Seed the RNG with a new value.
+
+            Args:
+               seed_value: New value for the seed of the RNG.
+            )pbdoc", py::arg("seed_value"))
+
+        .def_static("get_rng_state", &locked_rng_state,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the state of the RNG shared by the sets as a tuple
+            (state, increment), which can be restored with set_rng_state.
+            )pbdoc")
+
+        .def_static("set_rng_state", &locked_set_rng_state,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Restores a state of the RNG returned by get_rng_state.
+
+            Args:
+               state: Tuple (state, increment) of the RNG.
+            )pbdoc", py::arg("state"));
+}
+
+//template function to declare sets in shared memory
+//the sets lock themselves with a lock shared between processes
+template<typename T>
+void declare_shared_samplable_set(py::module &m, string typestr)
+{
+    string pyclass_name = typestr + string("SharedSamplableSet");
+
+    py::class_<SharedSamplableSet<T> >(m, pyclass_name.c_str())
+
+        .def(py::init<const string&, double, double, size_t>(),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Creates a set in a new shared memory segment.
+
+            Args:
+               name: Name of the segment, starting with a slash.
+               min_weight: Minimal weight for elements in the set.
+               max_weight: Maximal weight for elements in the set.
+               capacity: Maximal number of elements in the set.
+            )pbdoc", py::arg("name"), py::arg("min_weight"),
+            py::arg("max_weight"), py::arg("capacity"))
+
+        .def(py::init<const string&>(),
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Opens a set created in a shared memory segment by another
+            process.
+
+            Args:
+               name: Name of the segment.
+            )pbdoc", py::arg("name"))
+
+        .def_static("unlink", &SharedSamplableSet<T>::unlink, R"pbdoc(
+            Removes a shared memory segment. It is freed once no process
+            maps it.
+
+            Args:
+               name: Name of the segment.
+            )pbdoc", py::arg("name"))
+
+        .def("size", &SharedSamplableSet<T>::size,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the number of elements in the set.
+            )pbdoc")
+
+        .def("__len__", &SharedSamplableSet<T>::size,
+            py::call_guard<py::gil_scoped_release>())
+
+        .def("capacity", &SharedSamplableSet<T>::capacity, R"pbdoc(
+            Returns the maximal number of elements in the set.
+            )pbdoc")
+
+        .def("total_weight", &SharedSamplableSet<T>::total_weight,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the sum of the weights of the elements in the set.
+            )pbdoc")
+
+        .def("count", &SharedSamplableSet<T>::count,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the count of a certain element (0 or 1 since it is a set).
+
+            Args:
+               element: Element of the set.
+            )pbdoc", py::arg("element"))
+
+        .def("__contains__", &SharedSamplableSet<T>::count,
+            py::call_guard<py::gil_scoped_release>())
+
+        .def("get_weight", &SharedSamplableSet<T>::get_weight,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the weight of an element in the set.
+            )pbdoc", py::arg("element"))
+
+        .def("sample", [](const SharedSamplableSet<T>& shared_set)
+            {
+                lock_guard<recursive_mutex> rng_lock(
+                        BaseSamplableSet::rng_mutex());
+                return shared_set.sample();
+            }, py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns an element of the set randomly (according to weights) and
+            its weight as a tuple.
+            )pbdoc")
+
+        .def("sample_n", &sample_n_unlocked<T, SharedSamplableSet<T> >,
+            R"pbdoc(
+            Returns n elements of the set randomly (according to weights),
+            with replacement, and their weights as a tuple of arrays.
+
+            Args:
+               n: Number of samples.
+            )pbdoc", py::arg("n"))
+
+        .def("insert", &SharedSamplableSet<T>::insert,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Insert an element in the set with its associated weight.
+
+            Args:
+               element: Element of the set.
+               weight: Weight for random sampling.
+            )pbdoc", py::arg("element"), py::arg("weight") = 0)
+
+        .def("set_weight", &SharedSamplableSet<T>::set_weight,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Set weight for an element in the set.
+
+            Args:
+               element: Element of the set.
+               weight: Weight for random sampling.
+            )pbdoc", py::arg("element"), py::arg("weight"))
+
+        .def("erase", &SharedSamplableSet<T>::erase,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Remove an element from the set.
+
+            Args:
+               element: Element of the set.
+            )pbdoc", py::arg("element"))
+
+        .def("clear", &SharedSamplableSet<T>::clear,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Remove all elements from the set.
+            )pbdoc")
+
+        .def_static("seed", &locked_seed,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Seed the RNG with a new value.
+
+            Args:
+               seed_value: New value for the seed of the RNG.
+            )pbdoc", py::arg("seed_value"))
+
+        .def_static("get_rng_state", &locked_rng_state,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the state of the RNG of this process as a tuple
+            (state, increment), which can be restored with set_rng_state.
+            )pbdoc")
+
+        .def_static("set_rng_state", &locked_set_rng_state,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Restores a state of the RNG returned by get_rng_state.
+
+            Args:
+               state: Tuple (state, increment) of the RNG.
+            )pbdoc", py::arg("state"));
+}
+
+//map a snapshot with the mapped set class matching its type
+py::object open_mapped_samplable_set(py::module m, const string& path,
+        bool validate)
+{
+    SnapshotHeader header;
+    {
+        ifstream file(path, ios::binary);
+        if (not file)
+        {
+            throw runtime_error("Cannot open " + path + " for reading");
+        }
+        header = read_snapshot_header(file);
+    }
+    const vector<pair<string, string> > class_prefixes = {{"int", "Int"},
+        {"int64", "Int64"}, {"uint64", "UInt64"}, {"2int", "Tuple2Int"},
+        {"3int", "Tuple3Int"}};
+    string cpp_type = snapshot_cpp_type(header.signature);
+    for (const auto& type_prefix_pair : class_prefixes)
+    {
+        if (type_prefix_pair.first == cpp_type)
+        {
+            return m.attr((type_prefix_pair.second
+                        + "MappedSamplableSet").c_str())(path, validate);
+        }
+    }
+    throw py::value_error("Sets of " + cpp_type + " cannot be mapped, the "
+            "elements must have a fixed size");
+}
+
+//function to declare the python SamplableSet class
+void declare_python_samplable_set(py::module &m)
+{
+    py::class_<SampleIterator>(m, "SampleIterator")
+        .def("__iter__", [](py::object self) {return self;})
+        .def("__next__", &SampleIterator::next);
+
+    py::class_<PySamplableSet>(m, "SamplableSet", R"pbdoc(
+            This class implements a set which is samplable according to the
+            weight distribution of the elements.
+
+            The SamplableSet can be instanciated empty or from an iterable of
+            pairs of elements and weights respectively.
+
+            The type of the elements is chosen once, and the operations are
+            dispatched to a C++ samplable set of that type.
+            )pbdoc")
+
+        .def(py::init(&new_python_samplable_set), R"pbdoc(
+            Creates a new SamplableSet instance.
+
+            Args:
+               min_weight (float): Minimum weight a given element can have.
+               max_weight (float): Maximum weight a given element can have.
+               elements_weights (iterable of pairs or dict, optional): Elements
+                  with their weight with which the set will be instanciated.
+               cpp_type (str, optional): Type used in the C++ implementation.
+                  If 'elements_weights' is specified, the type will be infered
+                  from it.
+            )pbdoc", py::arg("min_weight"), py::arg("max_weight"),
+            py::arg("elements_weights") = py::none(),
+            py::arg("cpp_type") = py::none())
+
+        .def_property_readonly("min_weight", &PySamplableSet::min_weight)
+
+        .def_property_readonly("max_weight", &PySamplableSet::max_weight)
+
+        .def_property_readonly("cpp_type", &PySamplableSet::cpp_type)
+
+        .def_static("load", &load_python_samplable_set, R"pbdoc(
+            Loads a set from a snapshot file written by save. The type of the
+            elements is read from the file, and the state of the shared RNG
+            is restored if it was saved.
+
+            Args:
+               path (str): Path of the snapshot file.
+            )pbdoc", py::arg("path"))
+
+        .def_static("seed", &locked_seed,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Seed the RNG with a new value.
+
+            Args:
+               seed_value: New value for the seed of the RNG.
+            )pbdoc", py::arg("seed_value"))
+
+        .def_static("get_rng_state", &locked_rng_state,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Returns the state of the RNG shared by the sets as a tuple
+            (state, increment), which can be restored with set_rng_state.
+            )pbdoc")
+
+        .def_static("set_rng_state", &locked_set_rng_state,
+            py::call_guard<py::gil_scoped_release>(), R"pbdoc(
+            Restores a state of the RNG returned by get_rng_state.
+
+            Args:
+               state: Tuple (state, increment) of the RNG.
+            )pbdoc", py::arg("state"))
+
+        .def("__len__", [](const PySamplableSet& self)
+            {return self.typed().size();})
+
+        .def("size", [](const PySamplableSet& self)
+            {return self.typed().size();}, R"pbdoc(
+            Returns the number of elements in the set.
+            )pbdoc")
+
+        .def("total_weight", [](const PySamplableSet& self)
+            {return self.typed().total_weight();}, R"pbdoc(
+            Returns the sum of the weights of the elements.
+            )pbdoc")
+
+        .def("__contains__", [](const PySamplableSet& self,
+                py::handle element) {return self.typed().count(element) > 0;})
+
+        .def("count", [](const PySamplableSet& self, py::handle element)
+            {return self.typed().count(element);}, R"pbdoc(
+            Returns 1 if the element is in the set, 0 otherwise.
+            )pbdoc", py::arg("element"))
+
+        .def("__getitem__", &PySamplableSet::get_item)
+
+        .def("get_weight", &PySamplableSet::get_item, R"pbdoc(
+            Returns the weight of an element in the set.
+            )pbdoc", py::arg("element"))
+
+        .def("__setitem__", &PySamplableSet::set_item)
+
+        .def("set_weight", [](PySamplableSet& self, py::handle element,
+                double weight) {self.typed().set_weight(element, weight);},
+            R"pbdoc(
+            Set weight for an element in the set.
+            )pbdoc", py::arg("element"), py::arg("weight"))
+
+        .def("insert", [](PySamplableSet& self, py::handle element,
+                double weight) {self.typed().insert(element, weight);},
+            R"pbdoc(
+            Insert an element in the set with its associated weight. Elements
+            already in the set are left unchanged.
+            )pbdoc", py::arg("element"), py::arg("weight") = 0)
+
+        .def("__delitem__", [](PySamplableSet& self, py::handle element)
+            {self.typed().erase(element);})
+
+        .def("erase", [](PySamplableSet& self, py::handle element)
+            {self.typed().erase(element);}, R"pbdoc(
+            Remove an element from the set.
+            )pbdoc", py::arg("element"))
+
+        .def("clear", [](PySamplableSet& self) {self.typed().clear();},
+            R"pbdoc(
+            Remove all elements from the container.
+            )pbdoc")
+
+        .def("next", [](PySamplableSet& self) {self.iterator_call("next");},
+            R"pbdoc(
+            Move the iterator one element ahead.
+            )pbdoc")
+
+        .def("init_iterator", [](PySamplableSet& self)
+            {self.iterator_call("init_iterator");}, R"pbdoc(
+            Put the iterator at the beginning of the set.
+            )pbdoc")
+
+        .def("__iter__", [](const PySamplableSet& self)
+            {return self.typed().iter();}, py::keep_alive<0, 1>())
+
+        .def("sample", [](py::object self, size_t n_samples, bool replace)
+            -> py::object
+            {
+                if (n_samples == 1)
+                {
+                    return self.cast<PySamplableSet&>().sample(replace);
+                }
+                return py::cast(SampleIterator(self, n_samples, replace));
+            }, R"pbdoc(
+            Randomly samples the set according to the weights of each element.
+
+            Args:
+               n_samples (int, optional): If equal to 1, returns one element.
+                  If greater than 1, returns a generator that will return
+                  'n_samples' elements.
+               replace (bool, optional): If True (default), sample with
+                  replacement. If sampling without replacement, erases the
+                  elements from the set.
+
+            Returns: An element of the set or a generator of 'n_samples'
+            elements.
+            )pbdoc", py::arg("n_samples") = 1, py::arg("replace") = true)
+
+        .def("sample_n", [](const PySamplableSet& self, size_t n_samples)
+            {
+                try
+                {
+                    return self.typed().sample_n(n_samples);
+                }
+                catch (const out_of_range& error)
+                {
+                    throw py::key_error(error.what());
+                }
+            }, R"pbdoc(
+            Randomly samples the set with replacement according to the weights
+            of each element, in a single call.
+
+            Args:
+               n_samples (int): Number of samples.
+
+            Returns: A tuple (elements, weights) of arrays. Elements are in an
+            array of shape (n_samples,), or (n_samples, k) for tuples of k int.
+            For other types, they are in a list.
+            )pbdoc", py::arg("n_samples"))
+
+        .def("sample_counts", [](const PySamplableSet& self,
+                unsigned long n_samples)
+            {
+                try
+                {
+                    return self.typed().sample_counts(n_samples);
+                }
+                catch (const out_of_range& error)
+                {
+                    throw py::key_error(error.what());
+                }
+            }, R"pbdoc(
+            Randomly samples the set with replacement and counts the number of
+            times each element is drawn.
+
+            Args:
+               n_samples (int): Number of samples.
+
+            Returns: A tuple (elements, counts) of the elements drawn at least
+            once and their number of draws.
+            )pbdoc", py::arg("n_samples"))
+
+        .def("insert_array", [](PySamplableSet& self, py::object elements,
+                py::object weights)
+            {
+                self.array_checkup(elements);
+                self.typed().cpp_set().attr("insert_array")(elements, weights);
+            }, R"pbdoc(
+            Inserts the elements of an array with their associated weights.
+            Elements already in the set are left unchanged.
+
+            Args:
+               elements (numpy.ndarray): Array of shape (N,) of int elements,
+                  or of shape (N, k) of tuples of k int elements.
+               weights (numpy.ndarray): Array of shape (N,) of weights.
+            )pbdoc", py::arg("elements"), py::arg("weights"))
+
+        .def("set_weight_array", [](PySamplableSet& self, py::object elements,
+                py::object weights)
+            {
+                self.array_checkup(elements);
+                self.typed().cpp_set().attr("set_weight_array")(elements,
+                        weights);
+            }, R"pbdoc(
+            Sets the weights of the elements of an array.
+
+            Args:
+               elements (numpy.ndarray): Array of shape (N,) of int elements,
+                  or of shape (N, k) of tuples of k int elements.
+               weights (numpy.ndarray): Array of shape (N,) of weights.
+            )pbdoc", py::arg("elements"), py::arg("weights"))
+
+        .def("copy", &PySamplableSet::copy, R"pbdoc(
+            Returns a deep copy of the set.
+            )pbdoc")
+
+        .def("__copy__", &PySamplableSet::copy)
+
+        .def("__deepcopy__", [](const PySamplableSet& self, py::dict)
+            {return self.copy();})
+
+        .def("__getattr__", &PySamplableSet::get_attr)
+
+        .def("__str__", [](const PySamplableSet& self)
+            {
+                if (not self.specified())
+                {
+                    return string("SamplableSet of unspecified type");
+                }
+                size_t size = self.typed().size();
+                return "SamplableSet of " + self.cpp_type().cast<string>()
+                    + " containing " + to_string(size) + " element"
+                    + (size > 1 ? "s" : "");
+            })
+
+        .def("__repr__", [](py::object self) {return py::str(self);})
+
+        .def(py::pickle(
+            [](const PySamplableSet& self)
+            {
+                py::object cpp_set = py::none();
+                if (self.specified())
+                {
+                    cpp_set = self.typed().cpp_set();
+                }
+                return py::make_tuple(self.min_weight(), self.max_weight(),
+                        self.cpp_type(), cpp_set);
+            },
+            [](py::tuple state)
+            {
+                PySamplableSet* set = new PySamplableSet(
+                        state[0].cast<double>(), state[1].cast<double>(),
+                        py::none());
+                if (not state[3].is_none())
+                {
+                    set->specify(state[2], state[3]);
+                }
+                return set;
+            }));
+}
+
+PYBIND11_MODULE(_SamplableSet, m)
+{
+    m.attr("instrumented") = instrumented();
+    py::enum_<Command>(m, "Command", py::arithmetic())
+        .value("INSERT", INSERT_COMMAND)
+        .value("SET_WEIGHT", SET_WEIGHT_COMMAND)
+        .value("ERASE", ERASE_COMMAND)
+        .value("SAMPLE", SAMPLE_COMMAND)
+        .value("GET_WEIGHT", GET_WEIGHT_COMMAND);
+    declare_array_methods<int>(declare_samplable_set<int>(m, "Int"));
+    declare_samplable_set<string>(m, "String");
+    declare_array_methods<int64_t>(
+            declare_samplable_set<int64_t, LargeInGroupIndex>(m, "Int64"));
+    declare_array_methods<uint64_t>(
+            declare_samplable_set<uint64_t, LargeInGroupIndex>(m, "UInt64"));
+    declare_array_methods<Tuple2Int>(
+            declare_samplable_set<Tuple2Int>(m, "Tuple2Int"));
+    declare_array_methods<Tuple3Int>(
+            declare_samplable_set<Tuple3Int>(m, "Tuple3Int"));
+    declare_samplable_set<Tuple2String>(m, "Tuple2String");
+    declare_samplable_set<Tuple3String>(m, "Tuple3String");
+    declare_next_reaction_set<int>(m, "Int");
+    declare_next_reaction_set<string>(m, "String");
+    declare_next_reaction_set<Tuple2Int>(m, "Tuple2Int");
+    declare_next_reaction_set<Tuple3Int>(m, "Tuple3Int");
+    declare_next_reaction_set<Tuple2String>(m, "Tuple2String");
+    declare_next_reaction_set<Tuple3String>(m, "Tuple3String");
+    declare_nested_samplable_set<int,int>(m, "Int");
+    declare_nested_samplable_set<string,string>(m, "String");
+    declare_pyobject_samplable_set(m);
+    declare_python_samplable_set(m);
+    declare_mapped_samplable_set<int>(m, "Int");
+    declare_mapped_samplable_set<int64_t>(m, "Int64");
+    declare_mapped_samplable_set<uint64_t>(m, "UInt64");
+    declare_mapped_samplable_set<Tuple2Int>(m, "Tuple2Int");
+    declare_mapped_samplable_set<Tuple3Int>(m, "Tuple3Int");
+    declare_shared_samplable_set<int>(m, "Int");
+    declare_shared_samplable_set<int64_t>(m, "Int64");
+    declare_shared_samplable_set<uint64_t>(m, "UInt64");
+    declare_shared_samplable_set<Tuple2Int>(m, "Tuple2Int");
+    declare_shared_samplable_set<Tuple3Int>(m, "Tuple3Int");
+    m.def("MappedSamplableSet", [m](const string& path, bool validate)
+        {return open_mapped_samplable_set(m, path, validate);}, R"pbdoc(
+        Opens a snapshot file written by save as a read-only set, which
+        samples directly from the file mapped in memory. Processes mapping
+        the same file share a single copy. The elements must be int, int64,
+        uint64 or tuples of int.
+
+        Args:
+           path (str): Path of the snapshot file.
+           validate (bool): If True, the weight of every element is checked,
+                            which reads the whole file. Otherwise only the
+                            header and the sizes of the groups are read.
+        )pbdoc", py::arg("path"), py::arg("validate") = false);
 }
@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Guillaume St-Onge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BINOMIAL_HPP_
+#define BINOMIAL_HPP_
+
+#include <random>
+
+namespace sset
+{//start of namespace sset
+
+//Number of trials below which Bernoulli trials are drawn one by one
+const unsigned long BINOMIAL_DIRECT_THRESHOLD = 16;
+
+/*
+ * Draw a binomial variate with n trials and success probability p.
+ * The number of trials is halved until it is small using the order
+ * statistics of uniform variates (Knuth, TAOCP vol. 2, sec. 3.4.1), then
+ * the remaining trials are drawn directly. Unlike some implementations of
+ * std::binomial_distribution, the variates are exact.
+ */
+template <class RNG>
+unsigned long binomial(unsigned long n, double p, RNG& gen)
+{
+    std::uniform_real_distribution<double> random_01(0.,1.);
+    unsigned long successes = 0;
+    while (n > BINOMIAL_DIRECT_THRESHOLD and p > 0. and p < 1.)
+    {
+        //the a-th smallest of n uniform variates is Beta(a, n+1-a)
+        unsigned long a = 1 + n/2;
+        unsigned long b = n + 1 - a;
+        std::gamma_distribution<double> gamma_a(a, 1.);
+        std::gamma_distribution<double> gamma_b(b, 1.);
+        double x = gamma_a(gen);
+        double y = x/(x + gamma_b(gen));
+        if (y >= p)
+        {
+            //the successes are among the a-1 smallest variates
+            n = a - 1;
+            p = p/y;
+        }
+        else
+        {
+            //the a smallest variates are successes
+            successes += a;
+            n = b - 1;
+            p = (p - y)/(1. - y);
+        }
+    }
+    if (p <= 0.)
+    {
+        return successes;
+    }
+    if (p >= 1.)
+    {
+        return successes + n;
+    }
+    for (unsigned long i = 0; i < n; i++)
+    {
+        if (random_01(gen) < p)
+        {
+            successes += 1;
+        }
+    }
+    return successes;
+}
+
+}//end of namespace sset
+
+#endif /* BINOMIAL_HPP_ */
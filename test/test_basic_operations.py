@@ -69,6 +69,105 @@ class TestContainerModification:
 
 
 
+    def test_insert_array(self):
+        s = SamplableSet(1, 10)
+        s.insert_array(np.arange(5), np.full(5, 2.))
+        assert s.cpp_type == 'int' and len(s) == 5 and s.total_weight() == 10.
+
+    def test_insert_array_tuple(self):
+        s = SamplableSet(1, 10)
+        s.insert_array(np.array([[0,1],[1,2]]), np.array([2.,3.]))
+        assert s.cpp_type == '2int' and s[(1,2)] == 3.
+
+    def test_set_weight_array(self):
+        s = SamplableSet(1, 10, {0:2., 1:2.})
+        s.set_weight_array(np.array([1,2]), np.array([5.,6.]))
+        assert s[0] == 2. and s[1] == 5. and s[2] == 6.
+
+    def test_insert_array_key_conversion(self):
+        s = SamplableSet(1, 10, cpp_type='int')
+        with pytest.raises(OverflowError):
+            s.insert_array(np.array([2**32 + 1]), np.array([2.]))
+        with pytest.raises(TypeError):
+            s.insert_array(np.array([1.5]), np.array([2.]))
+        s.insert_array(np.array([-3], dtype=np.int64), np.array([2.]))
+        assert len(s) == 1 and s[-3] == 2.
+
+    def test_insert_array_wrong_shape(self):
+        s = SamplableSet(1, 10, cpp_type='2int')
+        with pytest.raises(ValueError):
+            s.insert_array(np.arange(5), np.full(5, 2.))
+
+    def test_execute(self):
+        from SamplableSet import Command
+        s = SamplableSet(1, 10, {0:2.})
+        commands = np.array([int(Command.INSERT), int(Command.SET_WEIGHT),
+                             int(Command.ERASE), int(Command.SAMPLE),
+                             int(Command.GET_WEIGHT)], dtype=np.uint8)
+        elements = np.array([1, 0, 1, 0, 1])
+        weights = np.array([3., 5., 0., 0., 0.])
+        out_elements, out_weights = s.execute(commands, elements, weights)
+        assert np.isnan(out_weights[0]) and out_weights[1] == 2.
+        assert out_weights[2] == 3. and np.isnan(out_weights[4])
+        assert out_elements[3] == 0 and out_weights[3] == 5.
+        assert len(s) == 1 and s[0] == 5.
+
+    def test_load_text(self, tmp_path):
+        path = tmp_path / 'set.csv'
+        path.write_text('i,j,weight\n' +
+                        ''.join('{},{},{}\n'.format(i, 2*i, 1. + i % 99)
+                                for i in range(1000)))
+        s = SamplableSet(1, 100, cpp_type='2int')
+        s.load_text(str(path), skip_header=True, n_threads=3)
+        assert len(s) == 1000 and s[(10, 20)] == 11.
+
+    def test_load_text_str(self, tmp_path):
+        path = tmp_path / 'set.tsv'
+        path.write_text('a b\t2.5\nc\t3\n')
+        s = SamplableSet(1, 100, cpp_type='str')
+        s.load_text(str(path), delimiter='\t')
+        assert dict(s) == {'a b': 2.5, 'c': 3.}
+
+    def test_load_text_invalid(self, tmp_path):
+        path = tmp_path / 'set.csv'
+        path.write_text('1,2.\n2,x\n')
+        s = SamplableSet(1, 100, cpp_type='int')
+        with pytest.raises(ValueError):
+            s.load_text(str(path))
+
+    def test_load_npy(self, tmp_path):
+        np.save(str(tmp_path / 'elements.npy'), np.arange(10).reshape(5, 2))
+        np.save(str(tmp_path / 'weights.npy'), np.full(5, 2., dtype=np.float32))
+        s = SamplableSet(1, 100, cpp_type='2int')
+        s.load_npy(str(tmp_path / 'elements.npy'),
+                   str(tmp_path / 'weights.npy'))
+        assert len(s) == 5 and s[(8, 9)] == 2.
+
+
+    def test_memory_usage(self):
+        s = SamplableSet(1, 100, cpp_type='int')
+        empty_total = s.memory_usage()['total']
+        for i in range(1000):
+            s[i] = 1. + i % 99
+        usage = s.memory_usage()
+        assert usage['group_elements'] == 1000*16
+        assert usage['position_map_nodes'] > 0 and usage['tree_nodes'] > 0
+        assert usage['total'] > empty_total
+        assert usage['total'] == sum(v for k, v in usage.items()
+                                     if k != 'total')
+
+
+    def test_group_stats(self):
+        s = SamplableSet(1, 100, {i: 1. + i % 99 for i in range(1000)})
+        stats = s.group_stats()
+        assert len(stats['size']) == s.number_of_groups()
+        assert stats['size'].sum() == 1000
+        assert np.isclose(stats['weight'].sum(), s.total_weight())
+        assert np.all(stats['acceptance'] <= 1.)
+        empty_stats = SamplableSet(1, 100, cpp_type='int').group_stats()
+        assert np.all(np.isnan(empty_stats['acceptance']))
+
+
 class TestSampling:
     def test_sampling_single(self):
         elements = ['a']
@@ -120,6 +219,119 @@ class TestSampling:
                 sample_list.append(sample)
 
 
+    def test_sample_n(self):
+        s = SamplableSet(1, 100, {1:2.})
+        elements, weights = s.sample_n(10)
+        assert np.all(elements == 1) and np.all(weights == 2.)
+
+    def test_sample_n_tuple(self):
+        s = SamplableSet(1, 100, {(1,2,3):2.})
+        elements, weights = s.sample_n(10)
+        assert elements.shape == (10, 3) and np.all(elements[:,2] == 3)
+
+    def test_sample_n_str(self):
+        s = SamplableSet(1, 100, {'a':2.})
+        elements, weights = s.sample_n(3)
+        assert elements == ['a']*3 and len(weights) == 3
+
+    def test_sample_n_empty(self):
+        s = SamplableSet(1, 100, cpp_type='int')
+        with pytest.raises(KeyError):
+            s.sample_n(10)
+
+    def test_sample_counts(self):
+        elements_weights = {1:2., 2:3., 3:50.}
+        s = SamplableSet(1, 100, elements_weights)
+        elements, counts = s.sample_counts(10**6)
+        assert np.sum(counts) == 10**6 and len(s) == 3
+        assert set(elements) == {1, 2, 3}
+
+    def test_sample_counts_expected(self):
+        elements_weights = {i: 1. + i for i in range(50)}
+        s = SamplableSet(1, 100, elements_weights)
+        n = 10**7
+        elements, counts = s.sample_counts(n)
+        p = np.array([elements_weights[e] for e in elements])/s.total_weight()
+        assert len(elements) == 50 and np.sum(counts) == n
+        assert np.all(np.abs(counts - n*p) < 5*np.sqrt(n*p*(1 - p)))
+
+    def test_sample_counts_single(self):
+        s = SamplableSet(1, 100, {7: 3.})
+        elements, counts = s.sample_counts(10**12)
+        assert list(elements) == [7] and list(counts) == [10**12]
+
+    def test_sample_counts_empty(self):
+        s = SamplableSet(1, 100, cpp_type='int')
+        with pytest.raises(KeyError):
+            s.sample_counts(10)
+
+    def test_rng_state(self):
+        s = SamplableSet(1, 100, {i: 1. + i for i in range(100)})
+        SamplableSet.seed(42)
+        state = SamplableSet.get_rng_state()
+        samples = s.sample_n(100)[0]
+        SamplableSet.seed(7)
+        SamplableSet.set_rng_state(state)
+        assert np.all(s.sample_n(100)[0] == samples)
+
+    def test_rng_state_snapshot(self, tmp_path):
+        s = SamplableSet(1, 100, {i: 1. + i for i in range(100)})
+        path = str(tmp_path / 'set.snap')
+        s.save(path, with_rng_state=True)
+        samples = s.sample_n(100)[0]
+        s_copy = SamplableSet.load(path)
+        assert np.all(s_copy.sample_n(100)[0] == samples)
+
+    def test_counters(self):
+        import _SamplableSet
+        s = SamplableSet(1, 100, {i: 1. + i for i in range(100)})
+        s.reset_counters()
+        s.sample_n(1000)
+        s[3] = 90.
+        counters = s.counters()
+        if _SamplableSet.instrumented:
+            assert counters['samples'] == 1000
+            assert counters['rejection_trials'] >= 1000
+            assert counters['group_changes'] == 1
+            assert counters['tree_node_visits'] > 0
+        else:
+            assert set(counters.values()) == {0}
+
+    def test_threads(self):
+        from concurrent.futures import ThreadPoolExecutor
+        s = SamplableSet(1, 100, {i:50. for i in range(100)})
+        def modify(i):
+            for j in range(1000):
+                s[i] = 1. + (j % 99)
+                s.sample()
+        with ThreadPoolExecutor(4) as executor:
+            list(executor.map(modify, range(8)))
+        assert len(s) == 100
+        assert np.isclose(s.total_weight(), 92*50. + 8*(1. + 999 % 99))
+
+    def test_threads_objects(self):
+        import time
+        from concurrent.futures import ThreadPoolExecutor
+        class Key:
+            def __init__(self, value):
+                self.value = value
+            def __hash__(self):
+                return self.value % 4
+            def __eq__(self, other):
+                time.sleep(0) #lets another thread run
+                return self.value == other.value
+        s = SamplableSet(1, 100, {Key(-1): 1.})
+        def modify(i):
+            for j in range(200):
+                s[Key(i)] = 1. + j % 99
+                del s[Key(i)]
+            s[Key(i)] = 2.
+        with ThreadPoolExecutor(4) as executor:
+            list(executor.map(modify, range(8)))
+        assert len(s) == 9 and np.isclose(s.total_weight(), 17.)
+        assert sorted(key.value for key, weight in s) == list(range(-1, 8))
+
+
 class TestInitialization:
     def test_dict_init(self):
         elements_weights = {3:33.3, 6:66.6}
@@ -147,6 +359,35 @@ class TestInitialization:
         assert s.cpp_type == 'int'
         assert len(s) == 1 and s[1] == 5.
 
+    def test_object_init(self):
+        elements_weights = {1.5:2., frozenset({1}):3., (1,'a',2.):4.}
+        s = SamplableSet(1,100, elements_weights, cpp_type='object')
+        assert s[frozenset({1})] == 3. and len(s) == 3
+        assert dict(s) == elements_weights
+
+    def test_object_infer(self):
+        s = SamplableSet(1,100)
+        s[1.5] = 2.
+        assert s.cpp_type == 'object' and 1.5 in s and 2.5 not in s
+        element, weight = s.sample()
+        assert element == 1.5 and weight == 2.
+
+    def test_object_unhashable(self):
+        with pytest.raises(ValueError):
+            s = SamplableSet(1,100, {})
+            s[[1,2]] = 2.
+
+    def test_int64_init(self):
+        s = SamplableSet(1,100, {2**40:2., -2**50:3.}, cpp_type='int64')
+        assert s[2**40] == 2. and -2**50 in s
+        s.insert_array(np.array([2**62]), np.array([5.]))
+        assert s[2**62] == 5. and len(s) == 3
+
+    def test_uint64_init(self):
+        s = SamplableSet(1,100, cpp_type='uint64')
+        s[2**64-1] = 2.
+        assert s.sample() == (2**64-1, 2.)
+
     def test_throw_error_1(self):
         with pytest.raises(ValueError):
             s = SamplableSet(0, 100)
@@ -168,3 +409,175 @@ class TestInitialization:
         with pytest.raises(RuntimeError):
             s = SamplableSet(1, 2)
             s.total_weight()
+
+
+class TestPickle:
+    def test_pickle(self):
+        import pickle
+        elements_weights = {(i, 2*i): 1. + i % 99 for i in range(1000)}
+        s = SamplableSet(1, 100, elements_weights)
+        s_copy = pickle.loads(pickle.dumps(s))
+        assert s_copy.cpp_type == '2int' and len(s_copy) == 1000
+        assert np.isclose(s_copy.total_weight(), s.total_weight())
+        assert dict(s_copy) == dict(s)
+        s_copy.sample()
+
+    def test_pickle_object(self):
+        import pickle
+        s = SamplableSet(1, 100, {1.5:2., frozenset({1}):3.})
+        s_copy = pickle.loads(pickle.dumps(s))
+        assert s_copy.cpp_type == 'object' and dict(s_copy) == dict(s)
+
+    def test_pickle_unspecified(self):
+        import pickle
+        s = pickle.loads(pickle.dumps(SamplableSet(1, 100)))
+        assert s.cpp_type is None
+        s['a'] = 2.
+        assert len(s) == 1
+
+
+class TestSnapshot:
+    def test_save_load(self, tmp_path):
+        elements_weights = {(i, 2*i): 1. + i % 99 for i in range(1000)}
+        s = SamplableSet(1, 100, elements_weights)
+        path = str(tmp_path / 'set.snap')
+        s.save(path)
+        s_copy = SamplableSet.load(path)
+        assert s_copy.cpp_type == '2int' and dict(s_copy) == dict(s)
+        assert s_copy.min_weight == 1 and s_copy.max_weight == 100
+
+    def test_save_load_str(self, tmp_path):
+        s = SamplableSet(1, 100, {'a':2., 'bc':3.})
+        path = str(tmp_path / 'set.snap')
+        s.save(path)
+        s_copy = SamplableSet.load(path)
+        assert s_copy.cpp_type == 'str' and s_copy['bc'] == 3.
+
+    def test_load_wrong_file(self, tmp_path):
+        path = tmp_path / 'set.snap'
+        path.write_bytes(b'not a snapshot')
+        with pytest.raises(ValueError):
+            SamplableSet.load(str(path))
+
+    def test_load_corrupt_file(self, tmp_path):
+        import struct
+        s = SamplableSet(1, 100, {3: 3.}, cpp_type='int')
+        path = tmp_path / 'set.snap'
+        s.save(str(path))
+        data = path.read_bytes()
+        length = struct.unpack_from('<Q', data, 16)[0]
+        bounds = 24 + (length + 7)//8*8
+        n_groups = struct.unpack_from('<Q', data, bounds + 16)[0]
+        groups = bounds + 32 + 8*n_groups
+        #weight of the element, in the second group
+        weight = groups + 16
+        for offset, value in [(16, 2**62), (bounds + 24, 2**62),
+                (groups, 2**62)]:
+            corrupt = bytearray(data)
+            struct.pack_into('<Q', corrupt, offset, value)
+            path.write_bytes(bytes(corrupt))
+            with pytest.raises(ValueError):
+                SamplableSet.load(str(path))
+        #weight of the element, then stored weights of the first, empty,
+        #group and of the second one
+        for offset, value in [(weight, 500.), (weight, 30.),
+                (weight, float('nan')), (bounds + 32, 1e6),
+                (bounds + 40, 3.5)]:
+            corrupt = bytearray(data)
+            struct.pack_into('<d', corrupt, offset, value)
+            path.write_bytes(bytes(corrupt))
+            with pytest.raises(ValueError):
+                SamplableSet.load(str(path))
+
+    def test_journal(self, tmp_path):
+        path = str(tmp_path / 'set.jrnl')
+        s = SamplableSet(1, 100, cpp_type='int')
+        s.start_journal(path)
+        for i in range(100):
+            s[i] = 1. + i
+        s[5] = 60.
+        del s[7]
+        s.stop_journal()
+        replica = SamplableSet(1, 100, cpp_type='int')
+        replica.replay(path)
+        assert dict(replica) == dict(s)
+        assert np.isclose(replica.total_weight(), s.total_weight())
+
+    def test_replay_not_recorded(self, tmp_path):
+        path = str(tmp_path / 'set.jrnl')
+        replica_path = str(tmp_path / 'replica.jrnl')
+        s = SamplableSet(1, 100, cpp_type='int')
+        s.start_journal(path)
+        for i in range(10):
+            s[i] = 1. + i
+        s.stop_journal()
+        replica = SamplableSet(1, 100, cpp_type='int')
+        replica.start_journal(replica_path)
+        replica.replay(path)
+        replica[20] = 5.
+        replica.stop_journal()
+        other = SamplableSet(1, 100, cpp_type='int')
+        other.replay(replica_path)
+        assert dict(other) == {20: 5.}
+
+    def test_mapped(self, tmp_path):
+        from SamplableSet import MappedSamplableSet
+        s = SamplableSet(1, 100, {i: 1. + i % 99 for i in range(1000)})
+        path = str(tmp_path / 'set.snap')
+        s.save(path)
+        m = MappedSamplableSet(path)
+        assert len(m) == 1000 and np.isclose(m.total_weight(), s.total_weight())
+        element, weight = m.sample()
+        assert s[element] == weight
+        elements, weights = m.sample_n(100)
+        assert np.all(weights == 1. + elements % 99)
+
+    def test_mapped_corrupt(self, tmp_path):
+        import struct
+        from SamplableSet import MappedSamplableSet
+        s = SamplableSet(1, 100, {3: 3.}, cpp_type='int')
+        path = tmp_path / 'set.snap'
+        s.save(str(path))
+        data = path.read_bytes()
+        length = struct.unpack_from('<Q', data, 16)[0]
+        bounds = 24 + (length + 7)//8*8
+        n_groups = struct.unpack_from('<Q', data, bounds + 16)[0]
+        groups = bounds + 32 + 8*n_groups
+        #positive weight stored for the first group, which is empty
+        corrupt = bytearray(data)
+        struct.pack_into('<d', corrupt, bounds + 32, 1e6)
+        path.write_bytes(bytes(corrupt))
+        with pytest.raises(ValueError):
+            MappedSamplableSet(str(path))
+        #weight of the element, only checked on demand
+        corrupt = bytearray(data)
+        struct.pack_into('<d', corrupt, groups + 16, 3.5)
+        path.write_bytes(bytes(corrupt))
+        assert len(MappedSamplableSet(str(path))) == 1
+        with pytest.raises(ValueError):
+            MappedSamplableSet(str(path), validate=True)
+
+    def test_mapped_str(self, tmp_path):
+        from SamplableSet import MappedSamplableSet
+        s = SamplableSet(1, 100, {'a':2.})
+        path = str(tmp_path / 'set.snap')
+        s.save(path)
+        with pytest.raises(ValueError):
+            MappedSamplableSet(path)
+
+    def test_shared(self):
+        import os
+        from SamplableSet import IntSharedSamplableSet
+        name = '/sset_test_{}'.format(os.getpid())
+        s = IntSharedSamplableSet(name, 1, 100, 1000)
+        try:
+            other = IntSharedSamplableSet(name)
+            for i in range(100):
+                s.insert(i, 1. + i)
+            other.erase(0)
+            assert len(s) == 99 and s.get_weight(50) == 51.
+            assert np.isclose(other.total_weight(), 5049.)
+            element, weight = other.sample()
+            assert weight == 1. + element
+        finally:
+            IntSharedSamplableSet.unlink(name)
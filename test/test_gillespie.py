@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Test the Gillespie simulation methods for the samplable set
+
+Author: Guillaume St-Onge <guillaume.st-onge.4@ulaval.ca>
+"""
+
+import pytest
+import numpy as np
+from SamplableSet import SamplableSet, IntNextReactionSet
+
+
+class TestDirectMethod:
+    def test_max_events(self):
+        s = SamplableSet(1, 10, {1:2., 2:3.})
+        times, elements, time = s.gillespie(max_events=10)
+        assert len(times) == 10 and len(elements) == 10
+        assert np.all(np.diff(times) > 0) and time == times[-1]
+
+    def test_max_time(self):
+        s = SamplableSet(1, 10, {1:2., 2:3.})
+        times, elements, time = s.gillespie(max_events=10**6, max_time=1.)
+        assert time == 1. and np.all(times <= 1.)
+
+    def test_erase(self):
+        s = SamplableSet(1, 10, {1:2., 2:3., 3:4.})
+        times, elements, time = s.gillespie(max_events=10, update='erase')
+        assert sorted(elements) == [1, 2, 3] and len(s) == 0
+
+    def test_callback(self):
+        s = SamplableSet(1, 10, {'a':2.})
+        def update(element):
+            s[element] = s[element] + 1
+        times, elements, time = s.gillespie(max_events=5, update=update)
+        assert list(elements) == ['a']*5 and s['a'] == 7.
+
+    def test_table(self):
+        s = SamplableSet(1, 10, {1:2.})
+        table = {1: [(1, 0.), (2, 3.)], 2: [(2, 1., 'add')]}
+        times, elements, time = s.gillespie(max_events=3, update=table)
+        assert list(elements) == [1, 2, 2] and s[2] == 5. and len(s) == 1
+
+    def test_callback_other_set(self):
+        s = SamplableSet(1, 10, {1:2.})
+        other = SamplableSet(1, 10, {2:3.})
+        samples = []
+        def update(element):
+            samples.append(other.sample()[0])
+        times, elements, time = s.gillespie(max_events=5, update=update)
+        assert samples == [2]*5
+
+    def test_invalid_update(self):
+        s = SamplableSet(1, 10, {1:2.})
+        with pytest.raises(ValueError):
+            s.gillespie(max_events=5, update=3)
+        with pytest.raises(ValueError):
+            s.gillespie(max_events=5, update={1: [(1, 2., 'mul')]})
+
+
+class TestNextReactionMethod:
+    def test_sample(self):
+        s = IntNextReactionSet(1, 10)
+        s.insert(1, 2.)
+        element, weight = s.sample()
+        assert element == 1 and weight == 2. and s.time() > 0
+
+    def test_set_weight(self):
+        s = IntNextReactionSet(1, 10)
+        s.insert(1, 2.)
+        s.insert(2, 3.)
+        s.set_weight(1, 4.)
+        assert s.get_weight(1) == 4. and s.total_weight() == 7.
+
+    def test_nan_weight(self):
+        s = IntNextReactionSet(1, 10)
+        s.insert(1, 2.)
+        with pytest.raises(ValueError):
+            s.insert(2, float('nan'))
+        with pytest.raises(ValueError):
+            s.set_weight(1, float('nan'))
+        assert s.get_weight(1) == 2. and s.size() == 1
+
+    def test_erase(self):
+        s = IntNextReactionSet(1, 10)
+        s.insert(1, 2.)
+        s.insert(2, 3.)
+        times, elements, time = s.gillespie(max_events=10, update='erase')
+        assert sorted(elements) == [1, 2] and s.empty()
+
+    def test_table(self):
+        s = IntNextReactionSet(1, 10)
+        s.insert(1, 2.)
+        times, elements, time = s.gillespie(max_events=2,
+                                            update={1: [(1, -2., 'add')]})
+        assert list(elements) == [1] and s.empty()
+
+    def test_max_time(self):
+        s = IntNextReactionSet(1, 10)
+        s.insert(1, 2.)
+        times, elements, time = s.gillespie(max_events=10**6, max_time=1.)
+        assert time == 1. and s.time() == 1. and np.all(times <= 1.)
+
+
+class TestTauLeaping:
+    def test_counts(self):
+        s = SamplableSet(1, 10, {1:2., 2:3.})
+        elements, counts = s.tau_leap(1000.)
+        assert sorted(elements) == [1, 2] and np.all(counts > 0)
+        assert abs(np.sum(counts)/5000. - 1) < 0.1 and len(s) == 2
+
+    def test_leap_size(self):
+        s = SamplableSet(1, 16, {1:2., 2:3.})
+        assert s.leap_size(0.1) == 0.1/4
+
+    def test_invalid_leap(self):
+        s = SamplableSet(1, 10, {1:2., 2:3.})
+        for tau in [-1., float('nan'), float('inf')]:
+            with pytest.raises(ValueError):
+                s.tau_leap(tau)
+        elements, counts = s.tau_leap(0.)
+        assert len(elements) == 0
+        for epsilon in [0., -1., float('nan'), float('inf')]:
+            with pytest.raises(ValueError):
+                s.leap_size(epsilon)
@@ -7,6 +7,7 @@ Author: Guillaume St-Onge <guillaume.st-onge.4@ulaval.ca>
 """
 
 from SamplableSet import SamplableSet
+import numpy as np
 import pytest
 
 class TestCppMethod:
@@ -63,3 +64,59 @@ def test_python_generator_empty():
     s.clear()
     expected = []
     assert list(expected) == list(s.__iter__())
+
+def test_python_generator_empty_groups():
+    elements = {1:1., 2:60., 3:61.}
+    s = SamplableSet(1,100,elements)
+    assert dict(s) == elements
+    del s[2]
+    assert len(list(s)) == 2
+
+
+def test_python_generator_modified():
+    s = SamplableSet(1,100,{i:10. for i in range(10)})
+    with pytest.raises(RuntimeError):
+        for element, weight in s:
+            s[element + 100] = 10.
+
+
+class TestArrays:
+    def test_to_arrays(self):
+        elements = {1:10., 2:50., 3:20.}
+        s = SamplableSet(1,100,elements)
+        keys, weights = s.to_arrays()
+        assert dict(zip(keys, weights)) == elements
+
+    def test_to_arrays_str(self):
+        elements = {'a':10., 'b':50.}
+        s = SamplableSet(1,100,elements)
+        keys, weights = s.to_arrays()
+        assert dict(zip(keys, weights)) == elements
+
+    def test_group_views(self):
+        elements = {1:10., 2:12., 3:50.}
+        s = SamplableSet(1,100,elements)
+        found = {}
+        for group_index in range(s.number_of_groups()):
+            keys = s.group_keys(group_index)
+            weights = s.group_weights(group_index)
+            found.update(zip(keys, weights))
+        assert found == elements
+
+    def test_group_copies_outlive_modifications(self):
+        s = SamplableSet(1,100,{i:10. for i in range(10)})
+        group_index = int(np.argmax(s.group_stats()['size']))
+        keys = s.group_keys(group_index)
+        weights = s.group_weights(group_index)
+        for i in range(10, 1000):
+            s[i] = 10.
+        s.clear()
+        assert list(keys) == list(range(10)) and np.all(weights == 10.)
+
+    def test_group_views_tuple(self):
+        elements = {(1,2):10., (3,4):12.}
+        s = SamplableSet(1,100,elements)
+        keys = np.concatenate([s.group_keys(g)
+                               for g in range(s.number_of_groups())])
+        assert keys.shape == (2, 2)
+        assert {tuple(k) for k in keys} == set(elements)
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Test the nested samplable set
+
+Author: Guillaume St-Onge <guillaume.st-onge.4@ulaval.ca>
+"""
+
+import pytest
+from SamplableSet import IntNestedSamplableSet
+
+
+class TestNestedSamplableSet:
+    def test_insert(self):
+        s = IntNestedSamplableSet(1, 10, 100)
+        s.insert(0, 1, 2.)
+        s.insert(0, 2, 3.)
+        s.insert(1, 1, 4.)
+        assert s.size() == 3 and s.number_of_subsets() == 2
+        assert s.get_weight(0) == 5. and s.total_weight() == 9.
+
+    def test_set_weight(self):
+        s = IntNestedSamplableSet(1, 10, 100)
+        s.insert(0, 1, 2.)
+        s.set_weight(0, 1, 8.)
+        assert s.get_weight(0, 1) == 8. and s.get_weight(0) == 8.
+
+    def test_erase_empties_subset(self):
+        s = IntNestedSamplableSet(1, 10, 100)
+        s.insert(0, 1, 2.)
+        s.erase(0, 1)
+        assert s.empty() and s.count(0) == 0 and s.total_weight() == 0
+
+    def test_erase_subset(self):
+        s = IntNestedSamplableSet(1, 10, 100)
+        s.insert(0, 1, 2.)
+        s.insert(0, 2, 2.)
+        s.insert(1, 1, 2.)
+        s.erase(0)
+        assert s.size() == 1 and s.total_weight() == 2.
+
+    def test_sample(self):
+        s = IntNestedSamplableSet(1, 10, 100)
+        s.insert(3, 4, 5.)
+        assert s.sample() == ((3, 4), 5.)
+
+    def test_total_weight_out_of_bound(self):
+        s = IntNestedSamplableSet(1, 10, 15)
+        s.insert(0, 1, 10.)
+        with pytest.raises(ValueError):
+            s.insert(0, 2, 10.)
+        assert s.size() == 1 and s.get_weight(0) == 10.
+
+    def test_set_weight_out_of_bound(self):
+        s = IntNestedSamplableSet(1, 10, 15)
+        s.insert(0, 1, 10.)
+        s.insert(0, 2, 4.)
+        with pytest.raises(ValueError):
+            s.set_weight(0, 2, 9.)
+        assert s.get_weight(0, 2) == 4. and s.total_weight() == 14.